@@ -4,7 +4,10 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "profiler.h"
+
 #include <string>
+#include <vector>
 
 class App {
 private:
@@ -15,6 +18,28 @@ private:
     float _last_glfw_time = 0, _glfw_time = 0;
     int _frame = 0;
 
+    bool _headless = false;
+    int _frame_limit = -1;
+    float _time_step = 0;
+
+    Profiler _profiler;
+    std::string _profile_path;
+
+    GLuint _fbo = 0, _color_rb = 0, _depth_rb = 0;
+    int _fb_width = 0, _fb_height = 0;
+
+    std::vector<GLuint> _pbos;
+    std::vector<GLsync> _pbo_fences;
+    std::vector<int> _pbo_frames;
+
+    void initHeadless();
+
+    void deinitHeadless();
+
+    void readFrame();
+
+    void deliverFrame(size_t slot);
+
     static void onKey(GLFWwindow *window, int key, int scan_code, int action, int mods);
 
     static void onSize(GLFWwindow *window, int width, int height);
@@ -48,6 +73,20 @@ protected:
 
     void swapBuffers();
 
+    /// render into an offscreen framebuffer of an invisible window; must be set before launch()
+    void setHeadless(bool headless);
+
+    /// stop after this many frames; negative runs until the window is closed
+    void setFrameLimit(int frames);
+
+    /// advance time by a fixed step each frame instead of following the clock; 0 follows the clock
+    void setTimeStep(float step);
+
+    /// percentiles of all profiler series are written here on exit; empty disables the dump
+    void setProfileOutput(std::string path);
+
+    Profiler &getProfiler();
+
     virtual void onKey(int key, int scan_code, int action, int mods) {}
 
     virtual void onSize(int width, int height) {}
@@ -56,6 +95,9 @@ protected:
 
     virtual void onMouseButton(int button, int action, int mods) {}
 
+    /// receives each headless frame as bottom-up RGBA8 rows, a few frames after it was drawn
+    virtual void onFrame(int frame, int width, int height, const unsigned char *pixels) {}
+
     virtual void init() {}
 
     virtual void display() {}
@@ -67,6 +109,10 @@ protected:
 public:
     GLFWwindow *getWindow();
 
+    bool isHeadless();
+
+    GLuint getFramebuffer();
+
     int getFrame();
 
     float getRate();
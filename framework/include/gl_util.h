@@ -6,12 +6,21 @@
 #include <glad/glad.h>
 
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace util {
-    template<typename T>
-    void bufferData(GLenum target, std::vector<T> data, GLenum usage) {
-        glBufferData(target, data.size() * sizeof(T), &data.front(), usage);
+    /// layout of the commands read by glDrawArraysIndirect and glMultiDrawArraysIndirect
+    struct DrawArraysIndirectCommand {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first;
+        GLuint base_instance;
+    };
+
+    template<typename T, typename Alloc>
+    void bufferData(GLenum target, const std::vector<T, Alloc> &data, GLenum usage) {
+        glBufferData(target, data.size() * sizeof(T), data.data(), usage);
     }
 
     template<typename T>
@@ -19,14 +28,101 @@ namespace util {
         glBufferData(target, sizeof(T), &data, usage);
     }
 
+    /*
+     * Ring of per-frame copies of a T in one persistently mapped, coherent
+     * buffer. Each frame the CPU writes the next slot while the GPU may still
+     * be reading earlier ones; a fence per slot guards reuse, so there is no
+     * need for glBufferSubData or glFinish.
+     */
+    template<typename T>
+    class StreamBuffer {
+        GLenum _target = 0;
+        GLuint _buffer = 0;
+        GLsizeiptr _stride = 0;
+        char *_mapped = nullptr;
+
+        std::vector<GLsync> _fences;
+        size_t _current = 0;
+
+    public:
+        void init(GLenum target, size_t frames = 3) {
+            _target = target;
+
+            GLint align = 1;
+            if (target == GL_UNIFORM_BUFFER)
+                glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+            else if (target == GL_SHADER_STORAGE_BUFFER)
+                glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+
+            _stride = ((GLsizeiptr) sizeof(T) + align - 1) / align * align;
+            _fences.assign(frames, nullptr);
+            _current = frames - 1;
+
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            glGenBuffers(1, &_buffer);
+            glBindBuffer(_target, _buffer);
+            glBufferStorage(_target, _stride * (GLsizeiptr) frames, nullptr, flags);
+            _mapped = (char *) glMapBufferRange(_target, 0, _stride * (GLsizeiptr) frames, flags);
+            glBindBuffer(_target, 0);
+        }
+
+        /// advances to the next slot, waiting until the GPU is done with it
+        T &next() {
+            _current = (_current + 1) % _fences.size();
+
+            auto &fence = _fences[_current];
+            if (fence) {
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+
+            return *(T *) (_mapped + _stride * (GLsizeiptr) _current);
+        }
+
+        /// binds the current slot to an indexed binding point
+        void bind(GLuint binding) const {
+            glBindBufferRange(_target, binding, _buffer, _stride * (GLsizeiptr) _current, sizeof(T));
+        }
+
+        /// marks the current slot busy until every command issued so far has completed
+        void fence() {
+            auto &fence = _fences[_current];
+            if (fence) glDeleteSync(fence);
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        GLuint buffer() const { return _buffer; }
+
+        void release() {
+            for (auto &fence : _fences) {
+                if (fence) glDeleteSync(fence);
+                fence = nullptr;
+            }
+
+            glBindBuffer(_target, _buffer);
+            glUnmapBuffer(_target);
+            glBindBuffer(_target, 0);
+            glDeleteBuffers(1, &_buffer);
+
+            _buffer = 0;
+            _mapped = nullptr;
+        }
+    };
+
+    /// sources are passed with explicit lengths straight from the mapped files
     void shaderFiles(GLuint shader, std::vector<std::string> &paths) {
-        std::vector<std::string> strs;
         std::vector<const char *> c_strs;
+        std::vector<GLint> lengths;
 
-        for (const auto &path : paths) strs.push_back(readFile(path));
-        for (const auto &str:strs) c_strs.push_back(str.c_str());
+        for (const auto &path : paths) {
+            auto str = resources().view(path);
+            c_strs.push_back(str.data());
+            lengths.push_back((GLint) str.size());
+        }
 
-        glShaderSource(shader, (GLsizei) c_strs.size(), &c_strs.front(), nullptr);
+        glShaderSource(shader, (GLsizei) c_strs.size(), c_strs.data(), lengths.data());
     }
 
     std::string shaderInfoLog(GLuint shader) {
@@ -71,6 +167,8 @@ namespace util {
             return buildShader(kind, "FRAGMENT", paths);
         case GL_GEOMETRY_SHADER:
             return buildShader(kind, "GEOMETRY", paths);
+        case GL_COMPUTE_SHADER:
+            return buildShader(kind, "COMPUTE", paths);
         default:
             return buildShader(kind, "?", paths);
         }
@@ -88,13 +186,16 @@ namespace util {
             return buildShader(GL_FRAGMENT_SHADER, paths);
         } else if (ext == ".geom") {
             return buildShader(GL_GEOMETRY_SHADER, paths);
+        } else if (ext == ".comp") {
+            return buildShader(GL_COMPUTE_SHADER, paths);
         } else {
             fprintf(stderr, "Cannot parse path %s\n", path.c_str());
             return 0;
         }
     }
 
-    GLuint buildProgram(bool separable, std::vector<GLuint> shaders) {
+    /// `feedback` names the outputs captured, interleaved, by transform feedback
+    GLuint buildProgram(bool separable, std::vector<GLuint> shaders, const std::vector<const char *> &feedback) {
         GLuint program = glCreateProgram();
 
         if (separable)
@@ -103,6 +204,9 @@ namespace util {
         for (GLuint shader : shaders)
             glAttachShader(program, shader);
 
+        if (!feedback.empty())
+            glTransformFeedbackVaryings(program, (GLsizei) feedback.size(), feedback.data(), GL_INTERLEAVED_ATTRIBS);
+
         glLinkProgram(program);
 
         GLint link;
@@ -116,6 +220,10 @@ namespace util {
 
         return program;
     }
+
+    GLuint buildProgram(bool separable, std::vector<GLuint> shaders) {
+        return buildProgram(separable, std::move(shaders), {});
+    }
 }
 
 #endif //GL_TEMPLATE_UTIL_H
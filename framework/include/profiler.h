@@ -0,0 +1,94 @@
+#ifndef GL_TEMPLATE_PROFILER_H
+#define GL_TEMPLATE_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Frame instrumentation. CPU sections are timed with scoped timers; GPU
+ * passes are wrapped in GL_TIME_ELAPSED and GL_PRIMITIVES_GENERATED queries
+ * kept in a small ring per pass, so results are collected a few frames late
+ * instead of stalling on them. Every series keeps a rolling window of
+ * samples from which percentiles are reported.
+ */
+class Profiler {
+public:
+    struct Stats {
+        size_t count;
+        double mean, min, max;
+        double p50, p95, p99;
+    };
+
+    class CpuScope {
+        Profiler *_profiler;
+        std::string _name;
+        std::chrono::steady_clock::time_point _start;
+
+    public:
+        CpuScope(Profiler *profiler, std::string name);
+
+        CpuScope(CpuScope &&other) noexcept;
+
+        ~CpuScope();
+    };
+
+    class GpuScope {
+        Profiler *_profiler;
+        std::string _name;
+
+    public:
+        GpuScope(Profiler *profiler, std::string name);
+
+        GpuScope(GpuScope &&other) noexcept;
+
+        ~GpuScope();
+    };
+
+private:
+    struct Series {
+        std::vector<double> samples;
+        size_t next = 0;
+    };
+
+    struct Pass {
+        std::vector<GLuint> time_queries, prim_queries;
+        std::vector<bool> pending;
+        size_t next = 0;
+    };
+
+    size_t _window;
+    std::map<std::string, Series> _series;
+    std::map<std::string, Pass> _passes;
+
+    void beginPass(const std::string &name);
+
+    void endPass(const std::string &name);
+
+    void collect(const std::string &name, Pass &pass, size_t slot, bool wait);
+
+public:
+    explicit Profiler(size_t window = 4096);
+
+    void record(const std::string &name, double value);
+
+    CpuScope cpu(const std::string &name);
+
+    GpuScope gpu(const std::string &name);
+
+    /// picks up GPU query results that have become available without waiting
+    void endFrame();
+
+    Stats stats(const std::string &name) const;
+
+    /// writes percentiles of every series, as JSON if the path ends in .json and CSV otherwise
+    bool dump(const std::string &path);
+
+    /// waits for outstanding queries and frees them; needs the GL context to still be current
+    void release();
+};
+
+#endif //GL_TEMPLATE_PROFILER_H
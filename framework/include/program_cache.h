@@ -0,0 +1,343 @@
+#ifndef GL_TEMPLATE_PROGRAM_CACHE_H
+#define GL_TEMPLATE_PROGRAM_CACHE_H
+
+#include "gl_util.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+/*
+ * Builds programs from shader files and keeps the linked binaries on disk,
+ * keyed by a hash of the driver, the sources and the transform feedback
+ * outputs, so an unchanged program is loaded with glProgramBinary instead of
+ * being compiled. A binary the driver rejects is rebuilt from source.
+ *
+ * After watch(), poll() relinks the programs whose files have changed. The
+ * GLuint given to build() is updated in place, and the old program is kept
+ * when the new sources do not compile. A watched directory that is deleted
+ * and created again, as a build step copying shaders does, is watched again
+ * once it is back, and its programs are relinked.
+ */
+class ProgramCache {
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    struct Entry {
+        GLuint *program;
+        std::vector<std::string> paths;
+        std::vector<std::string> feedback;
+    };
+
+    std::string _dir;
+    std::string _driver;
+    std::vector<Entry> _entries;
+
+    int _notify = -1;
+    std::vector<std::pair<int, std::string>> _watches;
+    /// directories whose watch was removed with them, to watch again when they are back
+    std::vector<std::string> _lost;
+
+    size_t _loaded = 0, _compiled = 0;
+
+    /// FNV-1a
+    static uint64_t hash(std::string_view str, uint64_t h) {
+        for (char c : str) h = (h ^ (unsigned char) c) * 0x100000001b3ull;
+        return (h ^ 0xffu) * 0x100000001b3ull;
+    }
+
+    uint64_t key(const Entry &entry) {
+        if (_driver.empty()) {
+            for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+                auto str = (const char *) glGetString(name);
+                _driver += str ? str : "";
+                _driver += '\n';
+            }
+        }
+
+        uint64_t h = hash(_driver, 0xcbf29ce484222325ull);
+        for (const auto &path : entry.paths) h = hash(resources().view(path), hash(path, h));
+        for (const auto &name : entry.feedback) h = hash(name, h);
+        return h;
+    }
+
+    std::string binaryPath(uint64_t key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.prog", (unsigned long long) key);
+        return _dir + name;
+    }
+
+    GLuint load(uint64_t key) const {
+        FILE *file = fopen(binaryPath(key).c_str(), "rb");
+        if (!file) return 0;
+
+        Header header{};
+        std::vector<char> data;
+
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+            memcmp(header.magic, "SPRG", 4) == 0 && header.version == 1 && header.key == key;
+
+        if (ok) {
+            data.resize(header.length);
+            ok = fread(data.data(), 1, data.size(), file) == data.size();
+        }
+        fclose(file);
+        if (!ok) return 0;
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.format, data.data(), (GLsizei) data.size());
+
+        GLint link;
+        glGetProgramiv(program, GL_LINK_STATUS, &link);
+        if (!link) {
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        return program;
+    }
+
+    /// writes through a temporary file, so a concurrent launch never reads a partial binary
+    void save(uint64_t key, GLuint program) const {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        Header header{{'S', 'P', 'R', 'G'}, 1, key, 0, 0};
+        std::vector<char> data((size_t) length);
+        glGetProgramBinary(program, length, nullptr, (GLenum *) &header.format, data.data());
+        header.length = (uint32_t) length;
+
+        mkdir(_dir.c_str(), 0755);
+
+        auto path = binaryPath(key);
+        auto tmp = path + ".tmp";
+        FILE *file = fopen(tmp.c_str(), "wb");
+        if (!file) return;
+
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(data.data(), 1, data.size(), file);
+
+        bool ok = !ferror(file);
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(tmp.c_str(), path.c_str()) != 0) remove(tmp.c_str());
+    }
+
+    GLuint compile(const Entry &entry) const {
+        GLuint program = glCreateProgram();
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        std::vector<GLuint> shaders;
+        bool ok = true;
+        for (const auto &path : entry.paths) {
+            GLuint shader = util::buildShader(path);
+            ok = ok && shader;
+            shaders.push_back(shader);
+            if (shader) glAttachShader(program, shader);
+        }
+
+        std::vector<const char *> feedback;
+        for (const auto &name : entry.feedback) feedback.push_back(name.c_str());
+        if (!feedback.empty())
+            glTransformFeedbackVaryings(program, (GLsizei) feedback.size(), feedback.data(), GL_INTERLEAVED_ATTRIBS);
+
+        if (ok) glLinkProgram(program);
+
+        for (GLuint shader : shaders) {
+            if (!shader) continue;
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+        }
+
+        GLint link = GL_FALSE;
+        if (ok) glGetProgramiv(program, GL_LINK_STATUS, &link);
+        if (!link) {
+            if (ok) fprintf(stderr, "PROGRAM ERROR:\n%s", util::programInfoLog(program).c_str());
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        return program;
+    }
+
+    GLuint build(const Entry &entry, bool cached) {
+        auto k = key(entry);
+
+        GLuint program = cached ? load(k) : 0;
+        if (program) {
+            _loaded++;
+            return program;
+        }
+
+        program = compile(entry);
+        if (program) {
+            _compiled++;
+            save(k, program);
+        }
+        return program;
+    }
+
+    /// the directory part of `path` with its trailing slash, or "" for a bare name
+    static std::string dirOf(const std::string &path) {
+        auto slash = path.rfind('/');
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+#ifdef __linux__
+    bool addWatch(const std::string &dir) {
+        auto name = dir.empty() ? std::string(".") : dir.substr(0, dir.size() - 1);
+
+        // editors often save by renaming a new file over the old one, and
+        // build steps may replace the whole directory
+        int wd = inotify_add_watch(_notify, name.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+        if (wd < 0) return false;
+
+        for (const auto &w : _watches) if (w.first == wd) return true;
+        _watches.emplace_back(wd, dir);
+        return true;
+    }
+#endif
+
+public:
+    explicit ProgramCache(std::string dir = "cache") : _dir(std::move(dir)) {}
+
+    ProgramCache(const ProgramCache &) = delete;
+
+    ProgramCache &operator=(const ProgramCache &) = delete;
+
+    ~ProgramCache() {
+        if (_notify >= 0) close(_notify);
+    }
+
+    /*
+     * Links the program from `paths`, with the stage of each file taken from
+     * its extension, and stores it in `program`, which must outlive the cache
+     * for reloads to update it. Returns the program, or 0 on failure.
+     */
+    GLuint build(GLuint &program, std::vector<std::string> paths, const std::vector<const char *> &feedback = {}) {
+        Entry entry{&program, std::move(paths), {feedback.begin(), feedback.end()}};
+
+        program = build(entry, true);
+        _entries.push_back(std::move(entry));
+        return program;
+    }
+
+    /*
+     * Starts watching the directories of every file built so far; false where
+     * unsupported. Paths starting with `from` are read from `to` from now on,
+     * so that a build which copies the shaders can be pointed back at their
+     * sources, where they are edited.
+     */
+    bool watch(const std::string &from = "", const std::string &to = "") {
+#ifdef __linux__
+        if (_notify < 0) _notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_notify < 0) return false;
+
+        for (auto &entry : _entries) {
+            for (auto &path : entry.paths) {
+                if (from != to && path.compare(0, from.size(), from) == 0)
+                    path = to + path.substr(from.size());
+
+                addWatch(dirOf(path));
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// relinks programs whose files changed since the last poll; true if any program was replaced
+    bool poll() {
+        std::set<std::string> changed;
+
+#ifdef __linux__
+        if (_notify < 0) return false;
+
+        alignas(inotify_event) char buf[4096];
+        ssize_t len;
+        while ((len = read(_notify, buf, sizeof(buf))) > 0) {
+            for (ssize_t i = 0; i < len;) {
+                auto *event = (const inotify_event *) (buf + i);
+                i += sizeof(inotify_event) + event->len;
+
+                // a moved directory keeps its watch, which is dropped here like a deleted one's
+                if (event->mask & IN_MOVE_SELF) inotify_rm_watch(_notify, event->wd);
+
+                if (event->mask & IN_IGNORED) {
+                    for (size_t w = 0; w < _watches.size(); ++w) {
+                        if (_watches[w].first != event->wd) continue;
+                        _lost.push_back(_watches[w].second);
+                        _watches.erase(_watches.begin() + w);
+                        break;
+                    }
+                    continue;
+                }
+                if (!event->len) continue;
+
+                for (const auto &w : _watches)
+                    if (w.first == event->wd) changed.insert(w.second + event->name);
+            }
+        }
+
+        // a directory that is back may have been filled before it was watched, so all of its files count as changed
+        for (size_t l = 0; l < _lost.size();) {
+            if (!addWatch(_lost[l])) {
+                ++l;
+                continue;
+            }
+
+            for (const auto &entry : _entries)
+                for (const auto &path : entry.paths)
+                    if (dirOf(path) == _lost[l]) changed.insert(path);
+            _lost.erase(_lost.begin() + l);
+        }
+#endif
+
+        for (const auto &path : changed) resources().forget(path);
+
+        bool replaced = false;
+        for (auto &entry : _entries) {
+            bool stale = false;
+            for (const auto &path : entry.paths) stale = stale || changed.count(path);
+            if (!stale) continue;
+
+            GLuint program = build(entry, false);
+            if (!program) continue;
+
+            glDeleteProgram(*entry.program);
+            *entry.program = program;
+            replaced = true;
+        }
+
+        if (replaced) printf("programs: reloaded\n");
+        return replaced;
+    }
+
+    /// programs loaded from binaries and compiled from source so far
+    size_t loaded() const { return _loaded; }
+
+    size_t compiled() const { return _compiled; }
+};
+
+#endif //GL_TEMPLATE_PROGRAM_CACHE_H
@@ -1,28 +1,160 @@
 #ifndef GL_TEMPLATE_RESOURCE_H
 #define GL_TEMPLATE_RESOURCE_H
 
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-std::string readFile(const std::string &path) {
-    std::ifstream file(path);
-    if (!file) return std::string();
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-    file.ignore(std::numeric_limits<std::streamsize>::max());
-    auto size = file.gcount();
+/*
+ * A file mapped read-only. The view points straight into the page cache,
+ * so nothing is copied; it stays valid as long as the MappedFile does.
+ */
+class MappedFile {
+    void *_data = nullptr;
+    size_t _size = 0;
+    bool _open = false;
 
-    if (size > 0x10000) return std::string();
+    void reset() {
+        if (_data) munmap(_data, _size);
+        _data = nullptr;
+        _size = 0;
+        _open = false;
+    }
 
-    file.clear();
-    file.seekg(0, std::ios_base::beg);
+public:
+    MappedFile() = default;
 
-    std::stringstream sstr;
-    sstr << file.rdbuf();
-    file.close();
+    explicit MappedFile(const std::string &path) { open(path); }
 
-    return sstr.str();
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        reset();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_open, other._open);
+        return *this;
+    }
+
+    ~MappedFile() { reset(); }
+
+    bool open(const std::string &path) {
+        reset();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        // an empty file cannot be mapped, but is still a file
+        _size = (size_t) st.st_size;
+        if (_size) _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            _size = 0;
+            return false;
+        }
+
+        _open = true;
+        return true;
+    }
+
+    /// asks the kernel to read the whole file ahead, then faults in every page
+    void prefetch() const {
+        if (!_data) return;
+        madvise(_data, _size, MADV_WILLNEED);
+
+        volatile char sink = 0;
+        auto page = (size_t) sysconf(_SC_PAGESIZE);
+        for (size_t i = 0; i < _size; i += page) sink += ((const char *) _data)[i];
+    }
+
+    bool isOpen() const { return _open; }
+
+    std::string_view view() const { return {(const char *) _data, _size}; }
+};
+
+/*
+ * Mapped files shared by path. prefetch() maps and faults in a batch of
+ * files in parallel, one task per file, so startup waits for the disk once
+ * instead of once per asset; later lookups of those paths wait only for
+ * their own file. Missing files are remembered as empty.
+ */
+class Resources {
+    std::mutex _mutex;
+    std::map<std::string, std::shared_future<std::shared_ptr<MappedFile>>> _files;
+
+    static std::shared_ptr<MappedFile> map(const std::string &path) {
+        auto file = std::make_shared<MappedFile>(path);
+        file->prefetch();
+        return file;
+    }
+
+public:
+    void prefetch(const std::vector<std::string> &paths) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto &path : paths) {
+            if (_files.count(path)) continue;
+            _files[path] = std::async(std::launch::async, map, path).share();
+        }
+    }
+
+    /// the mapped file at `path`, mapped now if it was not prefetched
+    std::shared_ptr<MappedFile> file(const std::string &path) {
+        std::shared_future<std::shared_ptr<MappedFile>> future;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _files.find(path);
+            if (it == _files.end()) {
+                std::promise<std::shared_ptr<MappedFile>> mapped;
+                mapped.set_value(std::make_shared<MappedFile>(path));
+                it = _files.emplace(path, mapped.get_future().share()).first;
+            }
+            future = it->second;
+        }
+        return future.get();
+    }
+
+    /// contents of `path`, valid until the path is forgotten; empty if it cannot be read
+    std::string_view view(const std::string &path) {
+        return file(path)->view();
+    }
+
+    /// drops the mapping, so the next lookup sees the file as it is now
+    void forget(const std::string &path) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _files.erase(path);
+    }
+};
+
+inline Resources &resources() {
+    static Resources instance;
+    return instance;
+}
+
+/// a copy of the file's contents, or an empty string if it cannot be read
+inline std::string readFile(const std::string &path) {
+    return std::string(resources().view(path));
 }
 
 #endif //GL_TEMPLATE_RESOURCE_H
@@ -49,13 +49,42 @@ void App::setSize(int width, int height) {
 }
 
 void App::swapBuffers() {
-    glfwSwapBuffers(getWindow());
+    auto timer = _profiler.cpu("swap");
+    if (!_headless) glfwSwapBuffers(getWindow());
+}
+
+void App::setHeadless(bool headless) {
+    _headless = headless;
+}
+
+void App::setFrameLimit(int frames) {
+    _frame_limit = frames;
+}
+
+void App::setTimeStep(float step) {
+    _time_step = step;
+}
+
+void App::setProfileOutput(std::string path) {
+    _profile_path = std::move(path);
+}
+
+Profiler &App::getProfiler() {
+    return _profiler;
 }
 
 GLFWwindow *App::getWindow() {
     return _window;
 }
 
+bool App::isHeadless() {
+    return _headless;
+}
+
+GLuint App::getFramebuffer() {
+    return _fbo;
+}
+
 int App::getFrame() {
     return _frame;
 }
@@ -157,10 +186,93 @@ void App::onMouseButton(GLFWwindow *window, int button, int action, int mods) {
     if (app) app->onMouseButton(button, action, mods);
 }
 
+// number of frames in flight between glReadPixels and mapping the result
+const size_t READBACK_FRAMES = 3;
+
+void App::initHeadless() {
+    glfwGetFramebufferSize(getWindow(), &_fb_width, &_fb_height);
+
+    glGenRenderbuffers(1, &_color_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, _color_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _fb_width, _fb_height);
+
+    glGenRenderbuffers(1, &_depth_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depth_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _fb_width, _fb_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color_rb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth_rb);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "Headless framebuffer is incomplete\n");
+
+    _pbos.resize(READBACK_FRAMES);
+    _pbo_fences.assign(READBACK_FRAMES, nullptr);
+    _pbo_frames.assign(READBACK_FRAMES, -1);
+
+    glGenBuffers((GLsizei) _pbos.size(), _pbos.data());
+    for (auto pbo : _pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) _fb_width * _fb_height * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void App::deinitHeadless() {
+    for (size_t slot = 0; slot < _pbos.size(); ++slot) {
+        auto oldest = (_frame + slot) % _pbos.size();
+        if (_pbo_frames[oldest] >= 0) deliverFrame(oldest);
+    }
+
+    glDeleteBuffers((GLsizei) _pbos.size(), _pbos.data());
+    glDeleteFramebuffers(1, &_fbo);
+    glDeleteRenderbuffers(1, &_color_rb);
+    glDeleteRenderbuffers(1, &_depth_rb);
+
+    _pbos.clear();
+    _fbo = _color_rb = _depth_rb = 0;
+}
+
+void App::readFrame() {
+    auto slot = _frame % _pbos.size();
+
+    // the slot still holds the frame from READBACK_FRAMES ago, which should be done by now
+    if (_pbo_frames[slot] >= 0) deliverFrame(slot);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbos[slot]);
+    glReadPixels(0, 0, _fb_width, _fb_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _pbo_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _pbo_frames[slot] = _frame;
+}
+
+void App::deliverFrame(size_t slot) {
+    glClientWaitSync(_pbo_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(_pbo_fences[slot]);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbos[slot]);
+    auto size = (GLsizeiptr) _fb_width * _fb_height * 4;
+    auto *pixels = (const unsigned char *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (pixels) {
+        onFrame(_pbo_frames[slot], _fb_width, _fb_height, pixels);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _pbo_fences[slot] = nullptr;
+    _pbo_frames[slot] = -1;
+}
+
 int App::run() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, _gl_major);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, _gl_minor);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, _headless ? GLFW_FALSE : GLFW_TRUE);
 
     _title = "GLFW App";
 
@@ -169,7 +281,7 @@ int App::run() {
 
     _last_glfw_time = (float) glfwGetTime();
 
-    center();
+    if (!_headless) center();
 
     glfwSetWindowSizeCallback(getWindow(), App::onSize);
     glfwSetKeyCallback(getWindow(), App::onKey);
@@ -180,18 +292,39 @@ int App::run() {
     gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
     glfwSwapInterval(0);
 
+    if (_headless) initHeadless();
+
     init();
 
     _last_time = _time = 0;
 
     manager[getWindow()] = this;
-    while (!glfwWindowShouldClose(_window)) {
+    while (!glfwWindowShouldClose(_window) && (_frame_limit < 0 || _frame < _frame_limit)) {
         _glfw_time = (float) glfwGetTime();
 
-        _time += (_glfw_time - _last_glfw_time) * _rate;
+        if (_time_step > 0) {
+            _time += _time_step * _rate;
+        } else {
+            _time += (_glfw_time - _last_glfw_time) * _rate;
+        }
 
-        update();
-        display();
+        if (_headless) glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+
+        {
+            auto frame_timer = _profiler.cpu("frame");
+            {
+                auto timer = _profiler.cpu("update");
+                update();
+            }
+            {
+                auto timer = _profiler.cpu("display");
+                display();
+            }
+
+            if (_headless) readFrame();
+        }
+
+        _profiler.endFrame();
 
         _last_time = _time;
         _last_glfw_time = _glfw_time;
@@ -201,8 +334,13 @@ int App::run() {
     };
     manager.erase(getWindow());
 
+    if (_headless) deinitHeadless();
+
     deinit();
 
+    _profiler.release();
+    if (!_profile_path.empty()) _profiler.dump(_profile_path);
+
     glfwDestroyWindow(_window);
 
     return EXIT_SUCCESS;
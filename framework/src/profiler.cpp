@@ -0,0 +1,195 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// frames a GPU query may stay in flight before its slot is reused
+const size_t QUERY_FRAMES = 4;
+
+Profiler::CpuScope::CpuScope(Profiler *profiler, std::string name)
+    : _profiler(profiler), _name(std::move(name)), _start(std::chrono::steady_clock::now()) {}
+
+Profiler::CpuScope::CpuScope(CpuScope &&other) noexcept
+    : _profiler(other._profiler), _name(std::move(other._name)), _start(other._start) {
+    other._profiler = nullptr;
+}
+
+Profiler::CpuScope::~CpuScope() {
+    if (!_profiler) return;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - _start;
+    _profiler->record("cpu." + _name + ".ms", elapsed.count());
+}
+
+Profiler::GpuScope::GpuScope(Profiler *profiler, std::string name)
+    : _profiler(profiler), _name(std::move(name)) {
+    _profiler->beginPass(_name);
+}
+
+Profiler::GpuScope::GpuScope(GpuScope &&other) noexcept
+    : _profiler(other._profiler), _name(std::move(other._name)) {
+    other._profiler = nullptr;
+}
+
+Profiler::GpuScope::~GpuScope() {
+    if (_profiler) _profiler->endPass(_name);
+}
+
+Profiler::Profiler(size_t window) : _window(window) {}
+
+void Profiler::record(const std::string &name, double value) {
+    auto &series = _series[name];
+
+    if (series.samples.size() < _window) {
+        series.samples.push_back(value);
+    } else {
+        series.samples[series.next] = value;
+        series.next = (series.next + 1) % _window;
+    }
+}
+
+Profiler::CpuScope Profiler::cpu(const std::string &name) {
+    return CpuScope(this, name);
+}
+
+Profiler::GpuScope Profiler::gpu(const std::string &name) {
+    return GpuScope(this, name);
+}
+
+void Profiler::beginPass(const std::string &name) {
+    auto &pass = _passes[name];
+
+    if (pass.time_queries.empty()) {
+        pass.time_queries.resize(QUERY_FRAMES);
+        pass.prim_queries.resize(QUERY_FRAMES);
+        pass.pending.assign(QUERY_FRAMES, false);
+        glGenQueries(QUERY_FRAMES, pass.time_queries.data());
+        glGenQueries(QUERY_FRAMES, pass.prim_queries.data());
+    }
+
+    // the ring is full; this slot's result is QUERY_FRAMES old and almost certainly ready
+    if (pass.pending[pass.next]) collect(name, pass, pass.next, true);
+
+    glBeginQuery(GL_TIME_ELAPSED, pass.time_queries[pass.next]);
+    glBeginQuery(GL_PRIMITIVES_GENERATED, pass.prim_queries[pass.next]);
+}
+
+void Profiler::endPass(const std::string &name) {
+    auto &pass = _passes[name];
+
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    glEndQuery(GL_TIME_ELAPSED);
+
+    pass.pending[pass.next] = true;
+    pass.next = (pass.next + 1) % QUERY_FRAMES;
+}
+
+void Profiler::collect(const std::string &name, Pass &pass, size_t slot, bool wait) {
+    if (!wait) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(pass.time_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+    }
+
+    GLuint64 ns = 0, prims = 0;
+    glGetQueryObjectui64v(pass.time_queries[slot], GL_QUERY_RESULT, &ns);
+    glGetQueryObjectui64v(pass.prim_queries[slot], GL_QUERY_RESULT, &prims);
+
+    record("gpu." + name + ".ms", (double) ns / 1e6);
+    record("gpu." + name + ".prims", (double) prims);
+
+    pass.pending[slot] = false;
+}
+
+void Profiler::endFrame() {
+    for (auto &entry : _passes) {
+        auto &pass = entry.second;
+
+        // oldest first, so samples stay in submission order
+        for (size_t i = 0; i < QUERY_FRAMES; ++i) {
+            auto slot = (pass.next + i) % QUERY_FRAMES;
+            if (!pass.pending[slot]) continue;
+
+            collect(entry.first, pass, slot, false);
+            if (pass.pending[slot]) break;
+        }
+    }
+}
+
+Profiler::Stats Profiler::stats(const std::string &name) const {
+    Stats stats{};
+
+    auto it = _series.find(name);
+    if (it == _series.end() || it->second.samples.empty()) return stats;
+
+    auto samples = it->second.samples;
+    std::sort(samples.begin(), samples.end());
+
+    auto at = [&](double q) { return samples[(size_t) (q * (double) (samples.size() - 1) + .5)]; };
+
+    double sum = 0;
+    for (auto s : samples) sum += s;
+
+    stats.count = samples.size();
+    stats.mean = sum / (double) samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.p50 = at(.50);
+    stats.p95 = at(.95);
+    stats.p99 = at(.99);
+
+    return stats;
+}
+
+bool Profiler::dump(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write profile to %s\n", path.c_str());
+        return false;
+    }
+
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+    if (json) {
+        fprintf(file, "{\n");
+    } else {
+        fprintf(file, "series,count,mean,min,max,p50,p95,p99\n");
+    }
+
+    size_t i = 0;
+    for (const auto &entry : _series) {
+        auto s = stats(entry.first);
+
+        if (json) {
+            fprintf(file,
+                "  \"%s\": {\"count\": %zu, \"mean\": %g, \"min\": %g, \"max\": %g, "
+                "\"p50\": %g, \"p95\": %g, \"p99\": %g}%s\n",
+                entry.first.c_str(), s.count, s.mean, s.min, s.max, s.p50, s.p95, s.p99,
+                ++i < _series.size() ? "," : "");
+        } else {
+            fprintf(file, "%s,%zu,%g,%g,%g,%g,%g,%g\n",
+                entry.first.c_str(), s.count, s.mean, s.min, s.max, s.p50, s.p95, s.p99);
+        }
+    }
+
+    if (json) fprintf(file, "}\n");
+
+    fclose(file);
+    return true;
+}
+
+void Profiler::release() {
+    for (auto &entry : _passes) {
+        auto &pass = entry.second;
+
+        for (size_t i = 0; i < QUERY_FRAMES; ++i) {
+            auto slot = (pass.next + i) % QUERY_FRAMES;
+            if (pass.pending[slot]) collect(entry.first, pass, slot, true);
+        }
+
+        glDeleteQueries(QUERY_FRAMES, pass.time_queries.data());
+        glDeleteQueries(QUERY_FRAMES, pass.prim_queries.data());
+    }
+
+    _passes.clear();
+}
@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <framework.h>
+#include <gl_util.h>
+#include <vsr/vsr.h>
+
+#include "arena.h"
+#include "cull.h"
+#include "layout.h"
+#include "lod.h"
+#include "mesh.h"
+#include "rotor.h"
+#include "slice.h"
+#include "slicen.h"
+#include "solids.h"
+
+/*
+ * Micro-benchmarks for mesh generation, slicing and rendering. Each result
+ * is printed as one JSON object per line so runs can be collected and
+ * compared across commits.
+ */
+
+FILE *out = stdout;
+
+struct Result {
+    std::string name;
+    size_t size;
+    size_t iters;
+    double ns_per_iter;
+    double items_per_s;
+};
+
+void report(const Result &r) {
+    fprintf(out, "{\"name\": \"%s\", \"size\": %zu, \"iters\": %zu, \"ns_per_iter\": %.1f, \"items_per_s\": %.1f}\n",
+        r.name.c_str(), r.size, r.iters, r.ns_per_iter, r.items_per_s);
+    fflush(out);
+}
+
+volatile size_t sink;
+
+/// heap allocations made while `counting` is set, which only reportAllocations() does
+std::atomic<bool> counting{false};
+std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+    if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+    auto a = (size_t) align;
+    if (void *p = aligned_alloc(a, (size + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+
+/// runs `fn` until `budget` seconds have passed, reports the median iteration
+void bench(const std::string &name, size_t size, const std::function<size_t()> &fn, double budget = .25) {
+    using clock = std::chrono::steady_clock;
+
+    std::vector<double> times;
+    auto start = clock::now();
+
+    do {
+        auto t0 = clock::now();
+        sink = fn();
+        auto t1 = clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    } while (std::chrono::duration<double>(clock::now() - start).count() < budget || times.size() < 3);
+
+    std::sort(times.begin(), times.end());
+    double median = times[times.size() / 2];
+
+    report({name, size, times.size(), median, (double) size / median * 1e9});
+}
+
+/// k copies of m along x, to scale a benchmark input
+template<unsigned int prim>
+Mesh<prim> repeat(const Mesh<prim> &m, unsigned k) {
+    Mesh<prim> res({}, {});
+    for (unsigned i = 0; i < k; ++i)
+        res = std::move(res) + (m + glm::vec4(3.f * (float) i, 0, 0, 0));
+    return res;
+}
+
+/// heap allocations made by one call of `fn`, after a first call to warm up
+void reportAllocations(const std::string &name, const std::function<size_t()> &fn) {
+    sink = fn();
+
+    allocations = 0;
+    counting = true;
+    sink = fn();
+    counting = false;
+    size_t count = allocations.load();
+
+    fprintf(out, "{\"name\": \"%s\", \"allocations\": %zu}\n", name.c_str(), count);
+    fflush(out);
+}
+
+void benchSolids() {
+    bench("solids.cube", cube().size(), [] { return cube().size(); });
+    bench("solids.tesseract", tesseract().size(), [] { return tesseract().size(); });
+    bench("solids.tesseract_edge_frame", tesseract_edge_frame(.125f).size(),
+        [] { return tesseract_edge_frame(.125f).size(); });
+    bench("solids.tesseract_cell_frame", tesseract_cell_frame(.125f).size(),
+        [] { return tesseract_cell_frame(.125f).size(); });
+    bench("solids.simplify", tesseract_cell_frame(.125f).size(),
+        [] { return simplify(tesseract_cell_frame(.125f)).size(); });
+
+    // the same generators in a MeshArena, compacted into one block
+    auto frame = [] { return tesseract_cell_frame(.125f); };
+    auto simplified = [] { return simplify(tesseract_cell_frame(.125f)); };
+
+    bench("solids.tesseract_cell_frame.arena", tesseract_cell_frame(.125f).size(),
+        [&] { return buildMesh(frame).size(); });
+    bench("solids.simplify.arena", tesseract_cell_frame(.125f).size(),
+        [&] { return buildMesh(simplified).size(); });
+
+    reportAllocations("allocations.tesseract_cell_frame", [&] { return frame().size(); });
+    reportAllocations("allocations.tesseract_cell_frame.arena", [&] { return buildMesh(frame).size(); });
+    reportAllocations("allocations.simplify", [&] { return simplified().size(); });
+    reportAllocations("allocations.simplify.arena", [&] { return buildMesh(simplified).size(); });
+}
+
+void benchRotor() {
+    bench("rotor", 1000, [] {
+        float acc = 0;
+        for (int i = 0; i < 1000; ++i)
+            acc += rotor(glm::vec4(1, 1, 1, 0), glm::vec4(0, 0, 0, 1), (float) i * 1e-3f)[0][0];
+        return (size_t) acc;
+    });
+    bench("rotor.rot_xw", 1000, [] {
+        float acc = 0;
+        for (int i = 0; i < 1000; ++i)
+            acc += rot_xw((float) i * 1e-3f)[0][0];
+        return (size_t) acc;
+    });
+}
+
+void benchCombinators() {
+    auto base = tesseract_cell_frame(.125f);
+    auto mat = rot_xw(.3f);
+
+    for (unsigned k : {1u, 16u, 256u}) {
+        auto m = repeat(base, k);
+        auto n = m.size();
+        auto K = std::to_string(k);
+
+        bench("mesh.concat/" + K, 2 * n, [&] { return concat(m, m).size(); });
+        bench("mesh.transform/" + K, n, [&] { return transform(m, mat).size(); });
+        bench("mesh.offset/" + K, n, [&] { return offset(m, glm::vec4(1)).size(); });
+        bench("mesh.scale/" + K, n, [&] { return scale(m, 2.f).size(); });
+        bench("mesh.chain.eager/" + K, 4 * n, [&] {
+            Mesh<4> r = m + mat * m + mat * (m + glm::vec4(1)) + (m * 2.f);
+            return r.size();
+        });
+        bench("mesh.chain.lazy/" + K, 4 * n, [&] {
+            Mesh<4> r = lazy(m) + mat * lazy(m) + mat * (lazy(m) + glm::vec4(1)) + (lazy(m) * 2.f);
+            return r.size();
+        });
+        bench("mesh.chain.lazy_serial/" + K, 4 * n, [&] {
+            auto r = (lazy(m) + mat * lazy(m) + mat * (lazy(m) + glm::vec4(1)) + (lazy(m) * 2.f)).evalSerial();
+            return r.size();
+        });
+
+        std::vector<Mesh<4>> parts(16, m);
+        bench("mesh.concat_n/" + K, 16 * n, [&] { return concat(parts).size(); });
+
+        auto c = repeat(cube(), k * 32);
+        bench("mesh.fill/" + K, c.size(), [&] { return fill(c).size(); });
+        bench("mesh.join/" + K, c.size(), [&] { return join(c, c).size(); });
+    }
+}
+
+void benchSlicing() {
+    auto base = simplify(tesseract_cell_frame(.125f));
+    auto model = rotor(glm::vec4(1, 1, 1, 0), glm::vec4(0, 0, 0, 1), .7f);
+    glm::vec4 off(0, 0, 0, .2f);
+
+    for (unsigned k : {1u, 16u, 256u}) {
+        auto m = repeat(base, k);
+        auto K = std::to_string(k);
+
+        Slicer slicer;
+        std::vector<glm::vec4> tris;
+        bench("slice.cpu/" + K, m.size(), [&] {
+            tris.clear();
+            return slicer.slice(m, model, off, tris);
+        });
+
+        WIndex index;
+        bench("cull.build/" + K, m.size(), [&] {
+            index.build(m, model);
+            return (size_t) 0;
+        });
+
+        std::vector<unsigned> inds;
+        bench("cull.query/" + K, m.size(), [&] {
+            inds.clear();
+            return (size_t) index.cull(m, off.w, inds);
+        });
+        bench("cull.linear/" + K, m.size(), [&] {
+            inds.clear();
+            return (size_t) cullLinear(m, slicer, model, off, inds);
+        });
+
+        bench("wire.edges/" + K, m.size(), [&] { return (size_t) edges(m).size(); });
+
+        EdgeTable table;
+        table.build(m);
+        Mesh<3> sect({}, {});
+        bench("slice.indexed/" + K, m.size(), [&] {
+            sect.verts.clear();
+            sect.inds.clear();
+            return slicer.sliceIndexed(m, table, model, off, sect);
+        });
+    }
+}
+
+void reportLayout(const std::string &name, const LayoutStats &stats) {
+    fprintf(out, "{\"name\": \"%s\", \"acmr\": %.3f, \"atvr\": %.3f, \"line_misses\": %.3f}\n",
+        name.c_str(), stats.acmr, stats.atvr, stats.line_misses);
+    fflush(out);
+}
+
+/// cache behaviour of the vertex fetches as generated, shuffled, and after reorder()
+void benchLayout() {
+    auto base = simplify(tesseract_cell_frame(.125f));
+
+    for (unsigned k : {1u, 16u, 256u}) {
+        auto m = repeat(base, k);
+        auto K = std::to_string(k);
+
+        // the same primitives in random order, with vertices numbered by first use
+        std::vector<unsigned> order(m.size());
+        for (unsigned i = 0; i < order.size(); ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        Mesh<4> shuffled(m.verts, {});
+        for (auto p : order) shuffled.inds.insert(shuffled.inds.end(), &m.inds[p * 4], &m.inds[p * 4] + 4);
+        shuffled = renumber(shuffled);
+
+        auto reordered = reorder(m);
+
+        reportLayout("layout.generated/" + K, layoutStats(m));
+        reportLayout("layout.shuffled/" + K, layoutStats(shuffled));
+        reportLayout("layout.reordered/" + K, layoutStats(reordered));
+        reportLayout("layout.shuffled_reordered/" + K, layoutStats(reorder(shuffled)));
+
+        bench("layout.reorder/" + K, m.size(), [&] { return (size_t) reorder(m).size(); });
+        bench("layout.quantize/" + K, m.verts.size(), [&] { return quantize(m.verts).verts.size(); });
+
+        bench("lod.decimate/" + K, m.size(), [&] { return (size_t) decimate(m, m.size() / 2).size(); });
+    }
+}
+
+/// slicing a dim-polytope all the way down to triangles, as `--dim` does every frame
+template<std::size_t dim>
+void benchSliceN(const std::string &name, const MeshN<dim, dim> &polytope) {
+    auto rot = identityN<dim>();
+    for (unsigned i = 0; i + 1 < dim; ++i) rot = rot * rotN<dim>(i, i + 1, .3f + .1f * i);
+    auto m = transform(polytope, rot, VecN<dim>{});
+
+    std::array<float, dim - 3> h{};
+    SlicerN slicer;
+    bench("slicen." + name + "/" + std::to_string(dim), m.size(),
+        [&] { return (size_t) slicer.sliceTo3(m, h.data()).size(); });
+}
+
+void benchSlicingN() {
+    benchSliceN<5>("cube", hypercube<5>());
+    benchSliceN<6>("cube", hypercube<6>());
+    benchSliceN<6>("simplex", simplex<6>());
+    benchSliceN<6>("orthoplex", orthoplex<6>());
+}
+
+struct Matrices {
+    glm::mat4 model;
+    glm::vec4 offset;
+
+    glm::mat4 view;
+    glm::mat4 proj;
+};
+
+/// renders the geometry-shader section pass headlessly and reports throughput
+class BenchApp : public App {
+    Mesh<4> mesh;
+    Matrices matrices{};
+
+    GLuint cell_array{}, cell_vert_buf{}, cell_elem_arr_buf{}, matrix_buffer{}, inst_buf{};
+    GLuint sect_prog{};
+
+    std::chrono::steady_clock::time_point start;
+
+    void init() override {
+        GLuint main_vs = util::buildShader(GL_VERTEX_SHADER, {"shaders/main.vert"});
+        GLuint sect_fs = util::buildShader(GL_FRAGMENT_SHADER, {"shaders/sect.frag"});
+        GLuint sect_gs = util::buildShader(GL_GEOMETRY_SHADER, {"shaders/sect.geom"});
+        sect_prog = util::buildProgram(false, {main_vs, sect_fs, sect_gs});
+        glDeleteShader(main_vs);
+        glDeleteShader(sect_fs);
+        glDeleteShader(sect_gs);
+
+        glGenBuffers(1, &cell_vert_buf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, cell_vert_buf);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, cell_vert_buf);
+        util::bufferData(GL_SHADER_STORAGE_BUFFER, mesh.verts, GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glGenBuffers(1, &cell_elem_arr_buf);
+        glBindBuffer(GL_ARRAY_BUFFER, cell_elem_arr_buf);
+        util::bufferData(GL_ARRAY_BUFFER, mesh.inds, GL_STATIC_DRAW);
+
+        glGenVertexArrays(1, &cell_array);
+        glBindVertexArray(cell_array);
+        auto ind_loc = (GLuint) glGetAttribLocation(sect_prog, "vInds");
+        glEnableVertexAttribArray(ind_loc);
+        glVertexAttribIPointer(ind_loc, 4, GL_UNSIGNED_INT, sizeof(int) * 4, (void *) nullptr);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // a single identity instance; vInst is left disabled and reads the constant 0
+        std::vector<Instance> instances{{glm::mat4(1), glm::vec4(0)}};
+        glGenBuffers(1, &inst_buf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, inst_buf);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, inst_buf);
+        util::bufferData(GL_SHADER_STORAGE_BUFFER, instances, GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glVertexAttribI1i((GLuint) glGetAttribLocation(sect_prog, "vInst"), 0);
+
+        glGenBuffers(1, &matrix_buffer);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 1, matrix_buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, matrix_buffer);
+        util::bufferData(GL_UNIFORM_BUFFER, matrices, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glFinish();
+        start = std::chrono::steady_clock::now();
+    }
+
+    void update() override {
+        matrices.model = rotor(glm::vec4(1, 1, 1, 0), glm::vec4(0, 0, 0, 1), getTime() / 3);
+        matrices.offset = glm::vec4(0, 0, 0, sin(getTime() / 2) * 0.9f);
+        matrices.view = glm::lookAt(glm::vec3(0, 0, -4 * scale), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+        matrices.proj = glm::perspective(1.f, 16.f / 9, 0.1f, 20.0f * scale);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, matrix_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Matrices), &matrices);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void display() override {
+        int width, height;
+        glfwGetFramebufferSize(getWindow(), &width, &height);
+
+        glViewport(0, 0, width, height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_DEPTH_TEST);
+
+        glBindVertexArray(cell_array);
+        glUseProgram(sect_prog);
+        glDrawArrays(GL_POINTS, 0, mesh.size());
+        glBindVertexArray(0);
+
+        swapBuffers();
+    }
+
+    void deinit() override {
+        glFinish();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto frames = (double) getFrame();
+        report({"render.sect.frames/" + std::to_string(k), mesh.size(), (size_t) frames,
+            elapsed.count() / frames * 1e9, frames / elapsed.count()});
+        report({"render.sect.tets/" + std::to_string(k), mesh.size(), (size_t) frames,
+            elapsed.count() / frames * 1e9, frames * mesh.size() / elapsed.count()});
+    }
+
+    unsigned k;
+    float scale;
+
+public:
+    BenchApp(unsigned k, int frames) : App(4, 4), mesh(repeat(simplify(tesseract_cell_frame(.125f)), k)),
+                                       k(k), scale((float) k) {
+        setHeadless(true);
+        setFrameLimit(frames);
+        setTimeStep(1.f / 60);
+    }
+
+    /// App::launch() exits the process, so drive run() directly
+    int bench() {
+        if (!glfwInit()) return EXIT_FAILURE;
+        int code = run();
+        glfwTerminate();
+        return code;
+    }
+};
+
+int main(int argc, char **argv) {
+    int render_frames = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        bool more = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--render") && more) {
+            render_frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && more) {
+            out = fopen(argv[++i], "w");
+            if (!out) {
+                fprintf(stderr, "Cannot write results to %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [--render FRAMES] [--out FILE]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    benchSolids();
+    benchRotor();
+    benchCombinators();
+    benchSlicing();
+    benchSlicingN();
+    benchLayout();
+
+    if (render_frames > 0) {
+        for (unsigned k : {1u, 16u, 256u}) {
+            BenchApp app(k, render_frames);
+            if (app.bench() != EXIT_SUCCESS) return EXIT_FAILURE;
+        }
+    }
+
+    if (out != stdout) fclose(out);
+}
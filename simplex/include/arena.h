@@ -0,0 +1,170 @@
+#ifndef SIMPLEX_ARENA_H
+#define SIMPLEX_ARENA_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include <glm/vec4.hpp>
+
+#include "mesh.h"
+
+/*
+ * Storage for building meshes. Generators chain many combinators, and every
+ * intermediate mesh is freed as soon as the next one is built; in a
+ * MeshArena those allocations are pointer bumps in a few large blocks, all
+ * released at once when the arena closes. compact() then copies the result
+ * into a single aligned block that outlives the arena and can be uploaded
+ * as is.
+ */
+
+/// alignment of the vertex and index arrays in a CompactMesh, a cache line
+const size_t MESH_ALIGN = 64;
+
+/*
+ * While open, meshes constructed on this thread allocate from the arena.
+ * Those meshes must not outlive it: compact or copy whatever should survive
+ * before it closes. Arenas nest, and the arena itself is not thread-safe, so
+ * pool tasks must only write into meshes sized beforehand, as the
+ * combinators do.
+ *
+ * Moving a mesh keeps its storage, so a mesh moved out of the scope would
+ * dangle. The arena counts its live allocations and asserts on closing
+ * that none are left.
+ */
+class MeshArena : public std::pmr::memory_resource {
+    std::pmr::monotonic_buffer_resource _arena;
+    std::pmr::memory_resource *_previous;
+    size_t _live = 0;
+
+    void *do_allocate(size_t bytes, size_t align) override {
+        _live++;
+        return _arena.allocate(bytes, align);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t align) override {
+        _live--;
+        _arena.deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit MeshArena(size_t initial = 1u << 18,
+        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : _arena(initial, upstream), _previous(detail::meshResource()) {
+        detail::meshResource() = this;
+    }
+
+    MeshArena(const MeshArena &) = delete;
+
+    MeshArena &operator=(const MeshArena &) = delete;
+
+    ~MeshArena() override {
+        assert(_live == 0 && "a mesh outlived its MeshArena");
+        detail::meshResource() = _previous;
+    }
+};
+
+/*
+ * A mesh in one MESH_ALIGN-aligned allocation: the vertices, then the
+ * indices at the next aligned offset, as in a mesh cache file. The block can
+ * go to the GPU in one copy, with the index array at indOffset().
+ */
+template<unsigned int prim>
+class CompactMesh {
+    char *_data = nullptr;
+    size_t _bytes = 0;
+    size_t _vert_count = 0, _ind_count = 0, _ind_offset = 0;
+
+    void reset() {
+        if (_data) ::operator delete(_data, std::align_val_t(MESH_ALIGN));
+        _data = nullptr;
+        _bytes = _vert_count = _ind_count = _ind_offset = 0;
+    }
+
+    static size_t alignUp(size_t n) {
+        return (n + MESH_ALIGN - 1) / MESH_ALIGN * MESH_ALIGN;
+    }
+
+public:
+    CompactMesh() = default;
+
+    CompactMesh(const glm::vec4 *verts, size_t vert_count, const unsigned *inds, size_t ind_count)
+        : _vert_count(vert_count), _ind_count(ind_count), _ind_offset(alignUp(vert_count * sizeof(glm::vec4))) {
+        _bytes = alignUp(_ind_offset + ind_count * sizeof(unsigned));
+        if (!_bytes) return;
+
+        _data = (char *) ::operator new(_bytes, std::align_val_t(MESH_ALIGN));
+        memset(_data, 0, _bytes);
+        if (vert_count) memcpy(_data, verts, vert_count * sizeof(glm::vec4));
+        if (ind_count) memcpy(_data + _ind_offset, inds, ind_count * sizeof(unsigned));
+    }
+
+    CompactMesh(const CompactMesh &) = delete;
+
+    CompactMesh &operator=(const CompactMesh &) = delete;
+
+    CompactMesh(CompactMesh &&other) noexcept { *this = std::move(other); }
+
+    CompactMesh &operator=(CompactMesh &&other) noexcept {
+        reset();
+        std::swap(_data, other._data);
+        std::swap(_bytes, other._bytes);
+        std::swap(_vert_count, other._vert_count);
+        std::swap(_ind_count, other._ind_count);
+        std::swap(_ind_offset, other._ind_offset);
+        return *this;
+    }
+
+    ~CompactMesh() { reset(); }
+
+    const glm::vec4 *verts() const { return (const glm::vec4 *) _data; }
+
+    const unsigned *inds() const { return (const unsigned *) (_data + _ind_offset); }
+
+    size_t vertCount() const { return _vert_count; }
+
+    size_t indCount() const { return _ind_count; }
+
+    unsigned size() const { return (unsigned) (_ind_count / prim); }
+
+    /// the whole block, vertices first
+    const void *data() const { return _data; }
+
+    size_t bytes() const { return _bytes; }
+
+    size_t indOffset() const { return _ind_offset; }
+
+    /// an owning copy, allocated from the current mesh resource
+    Mesh<prim> mesh() const {
+        Mesh<prim> res({}, {});
+        res.verts.assign(verts(), verts() + _vert_count);
+        res.inds.assign(inds(), inds() + _ind_count);
+        return res;
+    }
+};
+
+template<unsigned int prim>
+CompactMesh<prim> compact(const Mesh<prim> &m) {
+    return CompactMesh<prim>(m.verts.data(), m.verts.size(), m.inds.data(), m.inds.size());
+}
+
+/*
+ * Runs `generate` with a MeshArena open and compacts the mesh it returns,
+ * so the only allocations that survive are the arena's blocks, already
+ * freed, and the compacted one.
+ */
+template<typename Generator>
+auto buildMesh(Generator generate, size_t initial = 1u << 18) {
+    MeshArena arena(initial);
+    return compact(generate());
+}
+
+#endif //SIMPLEX_ARENA_H
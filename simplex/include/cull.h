@@ -0,0 +1,173 @@
+#ifndef SIMPLEX_CULL_H
+#define SIMPLEX_CULL_H
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "mesh.h"
+#include "slice.h"
+
+/*
+ * Appends the index tuples of the cells cut by `offset + model * v`, w = 0,
+ * and returns how many there are. One SIMD pass over the vertices and one
+ * over the cells, for frames where the model matrix has just changed and an
+ * index would be used only once.
+ */
+inline unsigned cullLinear(const Mesh<4> &mesh, Slicer &slicer, const glm::mat4 &model, glm::vec4 offset,
+    std::vector<unsigned> &inds) {
+    slicer.transform(mesh, model, offset);
+
+    unsigned count = 0;
+    for (unsigned c = 0; c < mesh.size(); ++c) {
+        const unsigned *ind = &mesh.inds[c * 4];
+
+        // matches sect.geom: some vertex has w < 0 and some has w >= 0
+        unsigned below = 0;
+        for (int i = 0; i < 4; ++i) below += slicer.below[ind[i]];
+        if (below == 0 || below == 4) continue;
+
+        inds.insert(inds.end(), ind, ind + 4);
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ * Centered interval tree over the w-extent of each cell under a model
+ * matrix. The hyperplane offset is not baked in, so while only `offset.w`
+ * changes the tree is reused as is, and each query costs O(log n) plus the
+ * number of cells that actually straddle the hyperplane. Building it costs
+ * more than cullLinear(), so it only pays off once the model holds still.
+ */
+class WIndex {
+    struct Node {
+        float center;
+        int left, right;
+
+        /// cells containing `center`, as a range of both by_min and by_max
+        unsigned begin, end;
+    };
+
+    std::vector<float> wmin, wmax;
+
+    std::vector<Node> nodes;
+
+    /// per node: cells sorted by ascending wmin, and by descending wmax
+    std::vector<unsigned> by_min, by_max;
+
+    /// scratch for cull()
+    std::vector<unsigned> hits;
+
+    int build(std::vector<unsigned> &cells) {
+        if (cells.empty()) return -1;
+
+        std::vector<float> ends;
+        ends.reserve(cells.size() * 2);
+        for (auto c : cells) {
+            ends.push_back(wmin[c]);
+            ends.push_back(wmax[c]);
+        }
+        std::nth_element(ends.begin(), ends.begin() + ends.size() / 2, ends.end());
+        float center = ends[ends.size() / 2];
+
+        std::vector<unsigned> left, right;
+        auto begin = (unsigned) by_min.size();
+
+        for (auto c : cells) {
+            if (wmax[c] < center) {
+                left.push_back(c);
+            } else if (wmin[c] > center) {
+                right.push_back(c);
+            } else {
+                by_min.push_back(c);
+                by_max.push_back(c);
+            }
+        }
+
+        auto end = (unsigned) by_min.size();
+        std::sort(by_min.begin() + begin, by_min.end(), [&](unsigned a, unsigned b) { return wmin[a] < wmin[b]; });
+        std::sort(by_max.begin() + begin, by_max.end(), [&](unsigned a, unsigned b) { return wmax[a] > wmax[b]; });
+
+        cells.clear();
+        cells.shrink_to_fit();
+
+        auto node = (int) nodes.size();
+        nodes.push_back({center, -1, -1, begin, end});
+
+        int l = build(left);
+        int r = build(right);
+        nodes[node].left = l;
+        nodes[node].right = r;
+
+        return node;
+    }
+
+public:
+    void build(const Mesh<4> &mesh, const glm::mat4 &model) {
+        glm::vec4 row(model[0][3], model[1][3], model[2][3], model[3][3]);
+
+        std::vector<float> ws(mesh.verts.size());
+        for (size_t i = 0; i < ws.size(); ++i) {
+            const auto &v = mesh.verts[i];
+            ws[i] = row.x * v.x + row.y * v.y + row.z * v.z + row.w * v.w;
+        }
+
+        auto cells = mesh.size();
+        wmin.resize(cells);
+        wmax.resize(cells);
+
+        for (unsigned c = 0; c < cells; ++c) {
+            const unsigned *ind = &mesh.inds[c * 4];
+            float mn = ws[ind[0]], mx = mn;
+            for (int i = 1; i < 4; ++i) {
+                mn = std::min(mn, ws[ind[i]]);
+                mx = std::max(mx, ws[ind[i]]);
+            }
+            wmin[c] = mn;
+            wmax[c] = mx;
+        }
+
+        nodes.clear();
+        by_min.clear();
+        by_max.clear();
+
+        std::vector<unsigned> all(cells);
+        for (unsigned c = 0; c < cells; ++c) all[c] = c;
+        build(all);
+    }
+
+    /// appends the indices of cells that straddle the hyperplane at model-space w = h
+    void query(float h, std::vector<unsigned> &cells) const {
+        // matches sect.geom: some vertex has w < h and some has w >= h
+        int n = nodes.empty() ? -1 : 0;
+
+        while (n >= 0) {
+            const auto &node = nodes[n];
+
+            if (h <= node.center) {
+                for (auto i = node.begin; i < node.end && wmin[by_min[i]] < h; ++i)
+                    cells.push_back(by_min[i]);
+                n = node.left;
+            } else {
+                for (auto i = node.begin; i < node.end && wmax[by_max[i]] >= h; ++i)
+                    cells.push_back(by_max[i]);
+                n = node.right;
+            }
+        }
+    }
+
+    /// appends the index tuples of the cells cut by `offset.w + (model * v).w = 0`
+    unsigned cull(const Mesh<4> &mesh, float offset_w, std::vector<unsigned> &inds) {
+        hits.clear();
+        query(-offset_w, hits);
+
+        for (auto c : hits) inds.insert(inds.end(), &mesh.inds[c * 4], &mesh.inds[c * 4] + 4);
+
+        return (unsigned) hits.size();
+    }
+};
+
+#endif //SIMPLEX_CULL_H
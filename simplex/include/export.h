@@ -0,0 +1,99 @@
+#ifndef SIMPLEX_EXPORT_H
+#define SIMPLEX_EXPORT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <glm/vec4.hpp>
+
+#include "mesh.h"
+
+/*
+ * Writers for captured sections: triangles over vec4(x, y, z, w) vertices,
+ * either indexed or unindexed in the layout of the Section buffer. Data is
+ * streamed straight from the pointers given, which may be a mapped GPU
+ * buffer, so nothing proportional to the mesh is allocated.
+ */
+
+namespace detail {
+    inline bool endsWith(const std::string &s, const std::string &suffix) {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+/*
+ * Binary little-endian PLY. Triangle f is inds[3f..3f+2], or with `inds`
+ * null, the three consecutive vertices 3f..3f+2.
+ */
+bool writePly(const std::string &path, const glm::vec4 *verts, size_t vert_count,
+    const unsigned *inds, size_t ind_count) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    size_t faces = ind_count / 3;
+    fprintf(file,
+        "ply\n"
+        "format binary_little_endian 1.0\n"
+        "element vertex %zu\n"
+        "property float x\n"
+        "property float y\n"
+        "property float z\n"
+        "element face %zu\n"
+        "property list uchar uint vertex_indices\n"
+        "end_header\n",
+        vert_count, faces);
+
+    for (size_t i = 0; i < vert_count; ++i)
+        fwrite(&verts[i], sizeof(float), 3, file);
+
+    for (size_t f = 0; f < faces; ++f) {
+        uint8_t n = 3;
+        uint32_t tri[3];
+        for (size_t k = 0; k < 3; ++k) tri[k] = (uint32_t) (inds ? inds[f * 3 + k] : f * 3 + k);
+        fwrite(&n, 1, 1, file);
+        fwrite(tri, sizeof(uint32_t), 3, file);
+    }
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+bool writeObj(const std::string &path, const glm::vec4 *verts, size_t vert_count,
+    const unsigned *inds, size_t ind_count) {
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    for (size_t i = 0; i < vert_count; ++i)
+        fprintf(file, "v %g %g %g\n", verts[i].x, verts[i].y, verts[i].z);
+
+    // OBJ indices are 1-based
+    for (size_t f = 0; f < ind_count / 3; ++f) {
+        fprintf(file, "f");
+        for (size_t k = 0; k < 3; ++k) fprintf(file, " %zu", (size_t) (inds ? inds[f * 3 + k] : f * 3 + k) + 1);
+        fprintf(file, "\n");
+    }
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+/// picks the format from the extension: .obj, otherwise PLY
+bool writeSection(const std::string &path, const glm::vec4 *verts, size_t vert_count,
+    const unsigned *inds, size_t ind_count) {
+    if (detail::endsWith(path, ".obj")) return writeObj(path, verts, vert_count, inds, ind_count);
+    return writePly(path, verts, vert_count, inds, ind_count);
+}
+
+/// unindexed triangles, three vertices each
+bool writeSection(const std::string &path, const glm::vec4 *tris, size_t count) {
+    count -= count % 3;
+    return writeSection(path, tris, count, nullptr, count);
+}
+
+/// an indexed section, such as Slicer::sliceIndexed() builds
+bool writeSection(const std::string &path, const Mesh<3> &m) {
+    return writeSection(path, m.verts.data(), m.verts.size(), m.inds.data(), m.inds.size());
+}
+
+#endif //SIMPLEX_EXPORT_H
@@ -0,0 +1,228 @@
+#ifndef SIMPLEX_LAYOUT_H
+#define SIMPLEX_LAYOUT_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+#include "mesh.h"
+
+/*
+ * Memory layout of meshes for the GPU. The shaders fetch verts[inds[..]]
+ * from a storage buffer in primitive order, so primitives that are close in
+ * space should be close in the index buffer, and their vertices close in
+ * the vertex buffer. reorder() sorts primitives along a 4D Morton curve and
+ * then renumbers vertices in order of first use; layoutStats() measures the
+ * effect. Cached meshes are stored reordered, so a change to the order
+ * needs a MESH_GENERATOR_VERSION bump.
+ */
+
+namespace detail {
+    /// the low 16 bits of x moved to every fourth bit
+    inline uint64_t spread4(uint64_t x) {
+        x &= 0xffff;
+        x = (x | x << 24) & 0x000000ff000000ffull;
+        x = (x | x << 12) & 0x000f000f000f000full;
+        x = (x | x << 6) & 0x0303030303030303ull;
+        x = (x | x << 3) & 0x1111111111111111ull;
+        return x;
+    }
+
+    template<typename Verts>
+    void bounds(const Verts &verts, glm::vec4 &lo, glm::vec4 &hi) {
+        lo = glm::vec4(INFINITY);
+        hi = glm::vec4(-INFINITY);
+        for (const auto &v : verts) {
+            for (int k = 0; k < 4; ++k) {
+                lo[k] = std::min(lo[k], v[k]);
+                hi[k] = std::max(hi[k], v[k]);
+            }
+        }
+    }
+}
+
+/// vertices renumbered in order of first use by the primitives; unreferenced vertices are dropped
+template<unsigned int prim>
+Mesh<prim> renumber(const Mesh<prim> &m) {
+    std::vector<unsigned> used(m.verts.size(), (unsigned) -1);
+
+    Mesh<prim> res({}, {});
+    res.verts.reserve(m.verts.size());
+    res.inds.reserve(m.inds.size());
+
+    for (auto i : m.inds) {
+        if (used[i] == (unsigned) -1) {
+            used[i] = (unsigned) res.verts.size();
+            res.verts.push_back(m.verts[i]);
+        }
+        res.inds.push_back(used[i]);
+    }
+
+    return res;
+}
+
+/*
+ * Primitives sorted by the Morton code of their centroids, quantized to
+ * 16 bits per axis over the mesh's bounding cube, then renumbered. The primitives
+ * themselves, and the order of the vertices within each, are unchanged.
+ */
+template<unsigned int prim>
+Mesh<prim> reorder(const Mesh<prim> &m) {
+    glm::vec4 lo, hi;
+    detail::bounds(m.verts, lo, hi);
+
+    // one scale for every axis, so the curve follows the mesh's real proportions
+    float extent = 0;
+    for (int k = 0; k < 4; ++k) extent = std::max(extent, hi[k] - lo[k]);
+    float scl = extent > 0 ? 65535 / extent : 0;
+
+    std::vector<std::pair<uint64_t, unsigned>> keys(m.size());
+    parallelFor(0, m.size(), detail::grain / prim, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            glm::vec4 c(0);
+            for (unsigned j = 0; j < prim; ++j) c += m.verts[m.inds[p * prim + j]];
+            c = c / (float) prim;
+
+            uint64_t code = 0;
+            for (int k = 0; k < 4; ++k)
+                code |= detail::spread4((uint64_t) std::lround((c[k] - lo[k]) * scl)) << k;
+            keys[p] = {code, (unsigned) p};
+        }
+    });
+
+    std::sort(keys.begin(), keys.end());
+
+    Mesh<prim> sorted({}, {});
+    sorted.verts = m.verts;
+    sorted.inds.reserve(m.inds.size());
+    for (const auto &key : keys)
+        sorted.inds.insert(sorted.inds.end(), &m.inds[key.second * prim], &m.inds[key.second * prim] + prim);
+
+    return renumber(sorted);
+}
+
+struct LayoutStats {
+    /// vertex fetches missing a FIFO cache of recent vertices, per primitive and per referenced vertex
+    double acmr, atvr;
+
+    /// 64-byte lines of the vertex buffer missing an LRU cache of recent lines, per primitive
+    double line_misses;
+};
+
+/*
+ * Simulates the fetches of the primitives' vertices in index order: a FIFO
+ * post-transform cache of `cache` vertices for the classic ACMR, and an LRU
+ * data cache of `lines` 64-byte lines (four vec4s each) for the storage
+ * buffer reads of the geometry and compute passes.
+ */
+template<unsigned int prim>
+LayoutStats layoutStats(const Mesh<prim> &m, unsigned cache = 32, unsigned lines = 64) {
+    std::deque<unsigned> fifo;
+    std::vector<bool> in_fifo(m.verts.size()), referenced(m.verts.size());
+    size_t misses = 0, unique = 0;
+
+    std::list<size_t> lru;
+    std::unordered_map<size_t, std::list<size_t>::iterator> in_lru;
+    size_t line_misses = 0;
+
+    for (auto i : m.inds) {
+        if (!referenced[i]) {
+            referenced[i] = true;
+            unique++;
+        }
+
+        if (!in_fifo[i]) {
+            misses++;
+            in_fifo[i] = true;
+            fifo.push_back(i);
+            if (fifo.size() > cache) {
+                in_fifo[fifo.front()] = false;
+                fifo.pop_front();
+            }
+        }
+
+        size_t line = i * sizeof(glm::vec4) / 64;
+        auto it = in_lru.find(line);
+        if (it != in_lru.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+        } else {
+            line_misses++;
+            lru.push_front(line);
+            in_lru[line] = lru.begin();
+            if (lru.size() > lines) {
+                in_lru.erase(lru.back());
+                lru.pop_back();
+            }
+        }
+    }
+
+    double prims = std::max(1u, m.size());
+    return {misses / prims, (double) misses / std::max<size_t>(1, unique), line_misses / prims};
+}
+
+struct LayoutReport {
+    LayoutStats before, after;
+    bool reordered;
+};
+
+/*
+ * reorder(), kept only if it lowers the simulated ACMR. Meshes straight
+ * from the combinators are often better already: fill() and join() emit
+ * fans around shared vertices, which a curve over centroids cannot beat.
+ */
+template<unsigned int prim>
+Mesh<prim> optimizeLayout(const Mesh<prim> &m, LayoutReport *report = nullptr) {
+    auto res = reorder(m);
+
+    auto before = layoutStats(m);
+    auto after = layoutStats(res);
+    bool better = after.acmr < before.acmr;
+
+    if (report) *report = {before, better ? after : before, better};
+    return better ? res : m;
+}
+
+/*
+ * Vertices packed as int16 per component over the mesh bounds, a quarter of
+ * the size of vec4s; `v = q * scale + offset`. The error is at most half a
+ * step, (hi - lo) / 65534 / 2 per component.
+ */
+struct QuantizedVerts {
+    std::vector<std::array<int16_t, 4>> verts;
+    glm::vec4 scale, offset;
+
+    glm::vec4 operator[](size_t i) const {
+        const auto &q = verts[i];
+        return glm::vec4(q[0], q[1], q[2], q[3]) * scale + offset;
+    }
+};
+
+template<typename Verts>
+QuantizedVerts quantize(const Verts &verts) {
+    glm::vec4 lo, hi;
+    detail::bounds(verts, lo, hi);
+
+    QuantizedVerts res;
+    for (int k = 0; k < 4; ++k) {
+        res.scale[k] = hi[k] > lo[k] ? (hi[k] - lo[k]) / 65534 : 1;
+        res.offset[k] = (lo[k] + hi[k]) / 2;
+    }
+
+    res.verts.resize(verts.size());
+    for (size_t i = 0; i < verts.size(); ++i)
+        for (int k = 0; k < 4; ++k)
+            res.verts[i][k] = (int16_t) std::max(-32767l, std::min(32767l,
+                std::lround((verts[i][k] - res.offset[k]) / res.scale[k])));
+
+    return res;
+}
+
+#endif //SIMPLEX_LAYOUT_H
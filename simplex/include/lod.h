@@ -0,0 +1,464 @@
+#ifndef SIMPLEX_LOD_H
+#define SIMPLEX_LOD_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "layout.h"
+#include "mesh.h"
+
+/*
+ * Levels of detail for tetrahedral meshes in 4D, by greedy edge collapse.
+ *
+ * The error of moving a vertex is measured by quadrics, generalized to 4D:
+ * each tetrahedron contributes the squared distance to the 3-flat through
+ * it, and each boundary triangle, weighted heavily, the squared distance to
+ * its 2-flat. Solids lying in a single 3-flat, like the cell frames, are
+ * thus kept to their outline while their interiors are coarsened for free.
+ * Collapses that would turn any surrounding tetrahedron inside out are
+ * skipped.
+ */
+
+namespace detail {
+    /// squared distance to affine subspaces, as a symmetric 5x5 form over (x, 1)
+    struct Quadric {
+        std::array<double, 25> q{};
+        double weight = 0;
+
+        Quadric &operator+=(const Quadric &o) {
+            for (int i = 0; i < 25; ++i) q[i] += o.q[i];
+            weight += o.weight;
+            return *this;
+        }
+
+        double operator()(const glm::vec4 &v) const {
+            double x[5] = {v.x, v.y, v.z, v.w, 1};
+            double res = 0;
+            for (int i = 0; i < 5; ++i)
+                for (int j = 0; j < 5; ++j) res += x[i] * q[i * 5 + j] * x[j];
+            return res;
+        }
+
+        /// `weight` times the squared distance to the flat through `p` spanned by `basis`, orthonormal
+        static Quadric flat(const glm::vec4 &p, const glm::vec4 *basis, int n, double weight) {
+            // projector onto the normal space, P = I - sum e e^T
+            double P[4][4];
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    P[i][j] = i == j;
+                    for (int k = 0; k < n; ++k) P[i][j] -= (double) basis[k][i] * basis[k][j];
+                }
+            }
+
+            double Pp[4] = {};
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j) Pp[i] += P[i][j] * p[j];
+
+            double pPp = 0;
+            for (int i = 0; i < 4; ++i) pPp += p[i] * Pp[i];
+
+            Quadric res;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) res.q[i * 5 + j] = weight * P[i][j];
+                res.q[i * 5 + 4] = res.q[4 * 5 + i] = -weight * Pp[i];
+            }
+            res.q[24] = weight * pPp;
+            res.weight = weight;
+            return res;
+        }
+    };
+
+    /// Gram-Schmidt over `n` edge vectors; returns the rank-n volume factor, 0 when degenerate
+    inline double orthonormalize(glm::vec4 *e, int n) {
+        double volume = 1;
+        for (int k = 0; k < n; ++k) {
+            for (int j = 0; j < k; ++j) e[k] = e[k] - glm::dot(e[k], e[j]) * e[j];
+
+            float len = std::sqrt(glm::dot(e[k], e[k]));
+            if (len < 1e-12f) return 0;
+
+            e[k] = e[k] / len;
+            volume *= len;
+        }
+        return volume;
+    }
+
+    /// normal of the 3-flat through a tetrahedron, scaled by its volume
+    inline glm::vec4 normal4(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c, const glm::vec4 &d) {
+        glm::vec4 u = b - a, v = c - a, w = d - a;
+
+        auto det3 = [](float a0, float a1, float a2, float b0, float b1, float b2, float c0, float c1, float c2) {
+            return a0 * (b1 * c2 - b2 * c1) - a1 * (b0 * c2 - b2 * c0) + a2 * (b0 * c1 - b1 * c0);
+        };
+
+        return {
+            det3(u.y, u.z, u.w, v.y, v.z, v.w, w.y, w.z, w.w),
+            -det3(u.x, u.z, u.w, v.x, v.z, v.w, w.x, w.z, w.w),
+            det3(u.x, u.y, u.w, v.x, v.y, v.w, w.x, w.y, w.w),
+            -det3(u.x, u.y, u.z, v.x, v.y, v.z, w.x, w.y, w.z),
+        };
+    }
+}
+
+struct DecimateStats {
+    unsigned prims_before, prims_after;
+
+    /// the largest collapse error, roughly how far the surface moved
+    float error;
+};
+
+/*
+ * Collapses edges, cheapest first, until at most `target` tetrahedra are
+ * left or no collapse is allowed. Each surviving vertex moves to whichever
+ * of the two endpoints or their midpoint has the least error. A collapse
+ * must keep the mesh's topology (the link condition) and must not invert
+ * a neighbouring tetrahedron.
+ */
+Mesh<4> decimate(const Mesh<4> &m, unsigned target, DecimateStats *stats = nullptr) {
+    using detail::Quadric;
+
+    auto nv = (unsigned) m.verts.size();
+    auto nt = m.size();
+
+    std::vector<glm::vec4> pos(m.verts.begin(), m.verts.end());
+    std::vector<std::array<unsigned, 4>> tets(nt);
+    std::vector<bool> tet_alive(nt, true), vert_alive(nv, true);
+    std::vector<std::vector<unsigned>> vert_tets(nv);
+    std::vector<unsigned> version(nv, 0);
+    std::vector<Quadric> quadrics(nv);
+
+    unsigned alive = 0;
+    for (unsigned t = 0; t < nt; ++t) {
+        for (unsigned j = 0; j < 4; ++j) tets[t][j] = m.inds[t * 4 + j];
+
+        auto key = tets[t];
+        std::sort(key.begin(), key.end());
+        if (std::adjacent_find(key.begin(), key.end()) != key.end()) {
+            tet_alive[t] = false;
+            continue;
+        }
+
+        alive++;
+        for (auto v : tets[t]) vert_tets[v].push_back(t);
+    }
+
+    //region Quadrics
+    using Face = std::array<unsigned, 3>;
+    std::unordered_map<Face, unsigned, detail::ArrayHash<unsigned, 3>> face_count;
+    auto faceKey = [](unsigned a, unsigned b, unsigned c) {
+        Face f{a, b, c};
+        std::sort(f.begin(), f.end());
+        return f;
+    };
+
+    for (unsigned t = 0; t < nt; ++t) {
+        if (!tet_alive[t]) continue;
+        const auto &k = tets[t];
+
+        glm::vec4 e[3] = {pos[k[1]] - pos[k[0]], pos[k[2]] - pos[k[0]], pos[k[3]] - pos[k[0]]};
+        double volume = detail::orthonormalize(e, 3);
+        if (volume > 0) {
+            auto q = Quadric::flat(pos[k[0]], e, 3, volume);
+            for (auto v : k) quadrics[v] += q;
+        }
+
+        for (unsigned skip = 0; skip < 4; ++skip) {
+            unsigned f[3], n = 0;
+            for (unsigned j = 0; j < 4; ++j) if (j != skip) f[n++] = k[j];
+            face_count[faceKey(f[0], f[1], f[2])]++;
+        }
+    }
+
+    // outline faces weigh far more than volume, so the shape survives longer than its interior
+    const double boundary_weight = 1e3;
+    for (unsigned t = 0; t < nt; ++t) {
+        if (!tet_alive[t]) continue;
+        const auto &k = tets[t];
+
+        for (unsigned skip = 0; skip < 4; ++skip) {
+            unsigned f[3], n = 0;
+            for (unsigned j = 0; j < 4; ++j) if (j != skip) f[n++] = k[j];
+            if (face_count[faceKey(f[0], f[1], f[2])] != 1) continue;
+
+            glm::vec4 e[2] = {pos[f[1]] - pos[f[0]], pos[f[2]] - pos[f[0]]};
+            double area = detail::orthonormalize(e, 2);
+            if (area <= 0) continue;
+
+            auto q = Quadric::flat(pos[f[0]], e, 2, boundary_weight * area);
+            for (auto v : f) quadrics[v] += q;
+        }
+    }
+    //endregion
+
+    struct Candidate {
+        double cost;
+        unsigned a, b;
+        unsigned va, vb;
+        glm::vec4 target;
+
+        bool operator<(const Candidate &o) const { return cost > o.cost; }
+    };
+
+    std::priority_queue<Candidate> heap;
+
+    auto push = [&](unsigned a, unsigned b) {
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+
+        glm::vec4 options[3] = {pos[a], pos[b], (pos[a] + pos[b]) * .5f};
+        Candidate c{INFINITY, a, b, version[a], version[b], {}};
+        for (const auto &o : options) {
+            double cost = std::max(0.0, q(o));
+            if (cost < c.cost) {
+                c.cost = cost;
+                c.target = o;
+            }
+        }
+        heap.push(c);
+    };
+
+    auto pushAround = [&](unsigned v) {
+        std::unordered_set<unsigned> seen;
+        for (auto t : vert_tets[v]) {
+            if (!tet_alive[t]) continue;
+            for (auto u : tets[t])
+                if (u != v && seen.insert(u).second) push(std::min(u, v), std::max(u, v));
+        }
+    };
+
+    for (unsigned v = 0; v < nv; ++v) {
+        for (auto t : vert_tets[v]) {
+            for (auto u : tets[t])
+                if (u > v) push(v, u);
+        }
+    }
+
+    /// whether moving a and b to `to` keeps every other tetrahedron around them facing the same way
+    auto keepsOrientation = [&](unsigned a, unsigned b, const glm::vec4 &to) {
+        for (unsigned v : {a, b}) {
+            for (auto t : vert_tets[v]) {
+                if (!tet_alive[t]) continue;
+                const auto &k = tets[t];
+                if (std::count(k.begin(), k.end(), a) && std::count(k.begin(), k.end(), b)) continue;
+
+                glm::vec4 p[4], q[4];
+                for (unsigned j = 0; j < 4; ++j) {
+                    p[j] = pos[k[j]];
+                    q[j] = k[j] == a || k[j] == b ? to : p[j];
+                }
+
+                auto before = detail::normal4(p[0], p[1], p[2], p[3]);
+                auto after = detail::normal4(q[0], q[1], q[2], q[3]);
+                if (glm::dot(before, before) > 0 && glm::dot(before, after) <= 0) return false;
+            }
+        }
+        return true;
+    };
+
+    /*
+     * The link condition, Lk(a) ∩ Lk(b) = Lk(ab), over the mesh with its
+     * boundary coned to an extra vertex `omega`. When it holds, collapsing
+     * ab cannot pinch the mesh or fold tetrahedra onto each other.
+     */
+    using Simplex = std::array<unsigned, 3>;
+    const unsigned omega = nv, none = ~0u;
+
+    auto addFaces = [&](std::set<Simplex> &out, const unsigned *vs, unsigned n) {
+        for (unsigned mask = 1; mask < 1u << n; ++mask) {
+            Simplex s{none, none, none};
+            unsigned size = 0;
+            for (unsigned j = 0; j < n; ++j) if (mask >> j & 1) s[size++] = vs[j];
+            std::sort(s.begin(), s.end());
+            out.insert(s);
+        }
+    };
+
+    /// the link of vertex a, or of edge ab when b is not `none`
+    auto link = [&](unsigned a, unsigned b) {
+        std::set<Simplex> res;
+        std::map<Face, unsigned> tris;
+
+        for (auto t : vert_tets[a]) {
+            if (!tet_alive[t]) continue;
+            const auto &k = tets[t];
+            if (b != none && !std::count(k.begin(), k.end(), b)) continue;
+
+            unsigned rest[4], n = 0;
+            for (auto v : k) if (v != a && v != b) rest[n++] = v;
+            addFaces(res, rest, n);
+
+            // the triangles of t through a, or through ab
+            for (unsigned skip = 0; skip < 4; ++skip) {
+                if (k[skip] == a || k[skip] == b) continue;
+                unsigned f[3], m = 0;
+                for (unsigned j = 0; j < 4; ++j) if (j != skip) f[m++] = k[j];
+                tris[faceKey(f[0], f[1], f[2])]++;
+            }
+        }
+
+        // a boundary triangle lies in one tetrahedron, and gains the apex omega
+        for (const auto &tri : tris) {
+            if (tri.second != 1) continue;
+
+            unsigned rest[3], n = 0;
+            for (auto v : tri.first) if (v != a && v != b) rest[n++] = v;
+            rest[n++] = omega;
+            addFaces(res, rest, n);
+        }
+
+        return res;
+    };
+
+    auto linkCondition = [&](unsigned a, unsigned b) {
+        auto la = link(a, none), lb = link(b, none), lab = link(a, b);
+        for (const auto &s : la)
+            if (lb.count(s) && !lab.count(s)) return false;
+        return true;
+    };
+
+    float error = 0;
+
+    while (alive > target && !heap.empty()) {
+        auto c = heap.top();
+        heap.pop();
+
+        if (!vert_alive[c.a] || !vert_alive[c.b]) continue;
+        if (version[c.a] != c.va || version[c.b] != c.vb) continue;
+        if (!keepsOrientation(c.a, c.b, c.target)) continue;
+        if (!linkCondition(c.a, c.b)) continue;
+
+        // a merges into b
+        unsigned a = c.a, b = c.b;
+        pos[b] = c.target;
+        quadrics[b] += quadrics[a];
+        vert_alive[a] = false;
+        version[b]++;
+
+        for (auto t : vert_tets[a]) {
+            if (!tet_alive[t]) continue;
+            auto &k = tets[t];
+
+            if (std::count(k.begin(), k.end(), b)) {
+                tet_alive[t] = false;
+                alive--;
+                continue;
+            }
+
+            for (auto &v : k) if (v == a) v = b;
+            vert_tets[b].push_back(t);
+        }
+        vert_tets[a].clear();
+
+        auto &around = vert_tets[b];
+        around.erase(std::remove_if(around.begin(), around.end(), [&](unsigned t) { return !tet_alive[t]; }),
+            around.end());
+
+        // the weighted mean of the squared distances, as a length
+        double weight = quadrics[b].weight;
+        error = std::max(error, (float) std::sqrt(weight > 0 ? c.cost / weight : 0));
+        pushAround(b);
+    }
+
+    Mesh<4> res({}, {});
+    res.verts.assign(pos.begin(), pos.end());
+    res.inds.reserve(alive * 4);
+
+    for (unsigned t = 0; t < nt; ++t)
+        if (tet_alive[t]) res.inds.insert(res.inds.end(), tets[t].begin(), tets[t].end());
+
+    res = renumber(res);
+
+    if (stats) *stats = {nt, res.size(), error};
+    return res;
+}
+
+/// a sphere around every vertex of a mesh
+struct Bounds {
+    glm::vec4 center;
+    float radius;
+};
+
+template<unsigned int prim>
+Bounds bounds(const Mesh<prim> &m) {
+    glm::vec4 lo, hi;
+    detail::bounds(m.verts, lo, hi);
+
+    Bounds res{(lo + hi) * .5f, 0};
+    for (const auto &v : m.verts) {
+        auto d = v - res.center;
+        res.radius = std::max(res.radius, std::sqrt(glm::dot(d, d)));
+    }
+    return res;
+}
+
+/*
+ * A mesh and successively coarser versions of it, each with about `ratio`
+ * times the cells of the one before. Level 0 is the mesh itself.
+ */
+struct LodMesh {
+    std::vector<Mesh<4>> levels;
+    std::vector<float> errors;
+    Bounds bounds;
+
+    unsigned count() const { return (unsigned) levels.size(); }
+};
+
+LodMesh buildLod(const Mesh<4> &m, unsigned count = 5, float ratio = .5f) {
+    LodMesh res{{m}, {0}, bounds(m)};
+
+    for (unsigned i = 1; i < count; ++i) {
+        DecimateStats stats{};
+        auto next = decimate(res.levels.back(), (unsigned) ((float) res.levels.back().size() * ratio), &stats);
+
+        // nothing more could be collapsed, or nothing would be left
+        if (next.size() == 0 || next.size() >= res.levels.back().size()) break;
+
+        res.levels.push_back(std::move(next));
+        res.errors.push_back(std::max(stats.error, res.errors.back()));
+    }
+
+    return res;
+}
+
+/*
+ * Level for an object whose section spans `pixels` across on screen: full
+ * detail down to `full` pixels, then one level coarser per halving.
+ */
+inline unsigned lodLevel(float pixels, unsigned count, float full = 256) {
+    unsigned level = 0;
+    while (level + 1 < count && pixels < full) {
+        pixels *= 2;
+        level++;
+    }
+    return level;
+}
+
+/*
+ * Radius on screen, in pixels, of the section of an object's bounding
+ * sphere by the hyperplane w = 0, given its center after the full 4D
+ * transform and its radius after scaling. Negative when the hyperplane
+ * misses the sphere, so the object has no section at all.
+ */
+inline float sectionPixels(const glm::vec4 &center, float radius,
+    const glm::mat4 &view, const glm::mat4 &proj, float viewport_height) {
+    float r2 = radius * radius - center.w * center.w;
+    if (r2 < 0) return -1;
+
+    glm::vec4 eye = view * glm::vec4(center.x, center.y, center.z, 1);
+    float depth = std::max(-eye.z, 1e-3f);
+
+    return std::sqrt(r2) * proj[1][1] / depth * viewport_height / 2;
+}
+
+#endif //SIMPLEX_LOD_H
@@ -2,113 +2,281 @@
 #define SIMPLEX_MESH_H
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 
+#include "pool.h"
+
+namespace detail {
+    /// where meshes made on this thread allocate; the heap, unless a MeshArena is open
+    inline std::pmr::memory_resource *&meshResource() {
+        thread_local std::pmr::memory_resource *resource = std::pmr::new_delete_resource();
+        return resource;
+    }
+}
+
+/*
+ * Storage comes from the memory resource current on the constructing thread,
+ * so the combinators allocate from a MeshArena while one is open (arena.h).
+ * Moves keep the source's storage; copies take the current resource. A mesh
+ * must not outlive the arena it was allocated from, which the arena asserts.
+ */
 template<unsigned int prim>
 struct Mesh {
-    std::vector<glm::vec4> verts;
-    std::vector<unsigned> inds;
+    using Verts = std::pmr::vector<glm::vec4>;
+    using Inds = std::pmr::vector<unsigned>;
+
+    Verts verts;
+    Inds inds;
 
-    Mesh(std::vector<glm::vec4> verts, std::vector<unsigned> inds)
-        : verts(std::move(verts)), inds(std::move(inds)) {}
+    Mesh(Verts verts, Inds inds)
+        : verts(std::move(verts), detail::meshResource()), inds(std::move(inds), detail::meshResource()) {}
 
-    unsigned size() {
+    Mesh(const Mesh &m)
+        : verts(m.verts, detail::meshResource()), inds(m.inds, detail::meshResource()) {}
+
+    Mesh(Mesh &&m) noexcept = default;
+
+    Mesh &operator=(const Mesh &m) = default;
+
+    Mesh &operator=(Mesh &&m) = default;
+
+    unsigned size() const {
         return (unsigned) inds.size() / prim;
     }
 };
 
+/// a 4D affine map `v -> model * v + offset`, laid out to match std430
+struct Instance {
+    glm::mat4 model;
+    glm::vec4 offset;
+};
+
+/*
+ * One mesh drawn once per instance transform, instead of baking transformed
+ * copies into a single mesh.
+ */
 template<unsigned int prim>
-Mesh<prim> concat(Mesh<prim> m, Mesh<prim> n) {
-    Mesh<prim> res({}, {});
+struct InstancedMesh {
+    Mesh<prim> mesh;
+    std::vector<Instance> instances;
+
+    unsigned size() const {
+        return mesh.size() * (unsigned) instances.size();
+    }
 
-    for (auto v: m.verts) res.verts.push_back(v);
-    for (auto v: n.verts) res.verts.push_back(v);
+    /// the equivalent single mesh with every instance applied
+    Mesh<prim> bake() const {
+        Mesh<prim> res({}, {});
+        res.verts.reserve(mesh.verts.size() * instances.size());
+        res.inds.reserve(mesh.inds.size() * instances.size());
 
+        for (const auto &inst : instances) {
+            auto base = (unsigned) res.verts.size();
+            for (const auto &v : mesh.verts) res.verts.push_back(inst.model * v + inst.offset);
+            for (auto i : mesh.inds) res.inds.push_back(base + i);
+        }
+
+        return res;
+    }
+};
+
+/*
+ * Combinators come in two flavors: `const &` overloads which build a fresh,
+ * exactly reserved result, and `&&` overloads which reuse the storage of an
+ * expiring argument. Chains like `a + b + c` or `rot * (m + off)` therefore
+ * only copy the inputs they cannot steal.
+ *
+ * Per-vertex and per-index loops over more than detail::grain elements are
+ * split across the thread pool.
+ *
+ * Generated meshes are cached on disk, so changes here or in simplify()
+ * that alter their output must bump MESH_GENERATOR_VERSION.
+ */
+
+namespace detail {
+    constexpr size_t grain = 1u << 15;
+}
+
+template<unsigned int prim>
+Mesh<prim> concat(Mesh<prim> &&m, const Mesh<prim> &n) {
     auto off = (unsigned) m.verts.size();
+    auto start = m.inds.size();
 
-    for (auto i: m.inds) res.inds.push_back(i);
-    for (auto i: n.inds) res.inds.push_back(off + i);
+    m.verts.insert(m.verts.end(), n.verts.begin(), n.verts.end());
+    m.inds.resize(start + n.inds.size());
 
-    return res;
+    parallelFor(0, n.inds.size(), detail::grain, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) m.inds[start + i] = off + n.inds[i];
+    });
+
+    return std::move(m);
 }
 
 template<unsigned int prim>
-Mesh<prim> transform(Mesh<prim> m, glm::mat4 mat) {
-    Mesh<prim> res(m.verts, m.inds);
-    for (auto &vert : res.verts)
-        vert = mat * vert;
-    return res;
+Mesh<prim> concat(const Mesh<prim> &m, const Mesh<prim> &n) {
+    Mesh<prim> res({}, {});
+    res.verts.reserve(m.verts.size() + n.verts.size());
+    res.inds.reserve(m.inds.size() + n.inds.size());
+
+    res.verts.insert(res.verts.end(), m.verts.begin(), m.verts.end());
+    res.inds.insert(res.inds.end(), m.inds.begin(), m.inds.end());
+
+    return concat(std::move(res), n);
 }
 
+/// all of `ms` in order; each part's vertex and index offsets come from a parallel prefix sum
 template<unsigned int prim>
-Mesh<prim> offset(Mesh<prim> m, glm::vec4 off) {
-    Mesh<prim> res(m.verts, m.inds);
-    for (auto &vert : res.verts)
-        vert += off;
+Mesh<prim> concat(const std::vector<Mesh<prim>> &ms) {
+    std::vector<size_t> vert_first(ms.size()), ind_first(ms.size());
+    for (size_t k = 0; k < ms.size(); ++k) {
+        vert_first[k] = ms[k].verts.size();
+        ind_first[k] = ms[k].inds.size();
+    }
+
+    Mesh<prim> res({}, {});
+    res.verts.resize(parallelScan(vert_first, vert_first, 1024));
+    res.inds.resize(parallelScan(ind_first, ind_first, 1024));
+
+    parallelFor(0, ms.size(), 1, [&](size_t lo, size_t hi) {
+        for (size_t k = lo; k < hi; ++k) {
+            const auto &m = ms[k];
+            auto base = (unsigned) vert_first[k];
+
+            std::copy(m.verts.begin(), m.verts.end(), res.verts.begin() + vert_first[k]);
+            parallelFor(0, m.inds.size(), detail::grain, [&](size_t l, size_t h) {
+                for (size_t i = l; i < h; ++i) res.inds[ind_first[k] + i] = base + m.inds[i];
+            });
+        }
+    });
+
     return res;
 }
 
 template<unsigned int prim>
-Mesh<prim> scale(Mesh<prim> m, glm::vec4 scl) {
-    Mesh<prim> res(m.verts, m.inds);
-    for (auto &vert : res.verts)
-        vert *= scl;
-    return res;
+Mesh<prim> transform(Mesh<prim> &&m, const glm::mat4 &mat) {
+    parallelFor(0, m.verts.size(), detail::grain, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) m.verts[i] = mat * m.verts[i];
+    });
+    return std::move(m);
 }
 
 template<unsigned int prim>
-Mesh<prim> scale(Mesh<prim> m, float scl) {
-    return scale(m, glm::vec4(scl));
+Mesh<prim> transform(const Mesh<prim> &m, const glm::mat4 &mat) {
+    return transform(Mesh<prim>(m), mat);
 }
 
 template<unsigned int prim>
-Mesh<prim + 1> pyramid(Mesh<prim> m, glm::vec4 apex) {
-    Mesh<prim + 1> res(m.verts, {});
-    res.verts.push_back(apex);
-    auto apex_ind = (unsigned) res.verts.size() - 1;
+Mesh<prim> offset(Mesh<prim> &&m, glm::vec4 off) {
+    parallelFor(0, m.verts.size(), detail::grain, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) m.verts[i] += off;
+    });
+    return std::move(m);
+}
 
-    for (int i = 0; i < m.size(); ++i) {
-        for (int j = 0; j < prim; ++j) {
-            res.inds.push_back(m.inds[i * prim + j]);
-        }
-        res.inds.push_back(apex_ind);
-    }
+template<unsigned int prim>
+Mesh<prim> offset(const Mesh<prim> &m, glm::vec4 off) {
+    return offset(Mesh<prim>(m), off);
+}
 
-    return res;
+template<unsigned int prim>
+Mesh<prim> scale(Mesh<prim> &&m, glm::vec4 scl) {
+    parallelFor(0, m.verts.size(), detail::grain, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) m.verts[i] *= scl;
+    });
+    return std::move(m);
+}
+
+template<unsigned int prim>
+Mesh<prim> scale(const Mesh<prim> &m, glm::vec4 scl) {
+    return scale(Mesh<prim>(m), scl);
+}
+
+template<unsigned int prim>
+Mesh<prim> scale(Mesh<prim> &&m, float scl) {
+    return scale(std::move(m), glm::vec4(scl));
 }
 
 template<unsigned int prim>
-Mesh<prim + 1> fill(Mesh<prim> m) {
-    Mesh<prim + 1> res(m.verts, {});
+Mesh<prim> scale(const Mesh<prim> &m, float scl) {
+    return scale(m, glm::vec4(scl));
+}
 
-    for (int i = 0; i < m.size(); ++i) {
-        for (int j = 0; j < prim; ++j) {
-            res.inds.push_back(m.inds[i * prim + j]);
+namespace detail {
+    template<unsigned int prim>
+    typename Mesh<prim + 1>::Inds coneInds(const Mesh<prim> &m, unsigned apex_ind) {
+        typename Mesh<prim + 1>::Inds inds(meshResource());
+        inds.reserve(m.size() * (prim + 1));
+
+        for (unsigned i = 0; i < m.size(); ++i) {
+            for (unsigned j = 0; j < prim; ++j) {
+                inds.push_back(m.inds[i * prim + j]);
+            }
+            inds.push_back(apex_ind);
         }
-        res.inds.push_back(0);
+
+        return inds;
     }
+}
 
+template<unsigned int prim>
+Mesh<prim + 1> pyramid(Mesh<prim> &&m, glm::vec4 apex) {
+    auto inds = detail::coneInds(m, (unsigned) m.verts.size());
+    Mesh<prim + 1> res(std::move(m.verts), std::move(inds));
+    res.verts.push_back(apex);
     return res;
 }
 
 template<unsigned int prim>
-Mesh<prim + 1> join(Mesh<prim> m, Mesh<prim> n) {
+Mesh<prim + 1> pyramid(const Mesh<prim> &m, glm::vec4 apex) {
+    Mesh<prim + 1> res({}, detail::coneInds(m, (unsigned) m.verts.size()));
+    res.verts.reserve(m.verts.size() + 1);
+    res.verts.insert(res.verts.end(), m.verts.begin(), m.verts.end());
+    res.verts.push_back(apex);
+    return res;
+}
+
+template<unsigned int prim>
+Mesh<prim + 1> fill(Mesh<prim> &&m) {
+    auto inds = detail::coneInds(m, 0);
+    return Mesh<prim + 1>(std::move(m.verts), std::move(inds));
+}
+
+template<unsigned int prim>
+Mesh<prim + 1> fill(const Mesh<prim> &m) {
+    return Mesh<prim + 1>(m.verts, detail::coneInds(m, 0));
+}
+
+template<unsigned int prim>
+Mesh<prim + 1> join(const Mesh<prim> &m, const Mesh<prim> &n) {
     Mesh<prim + 1> res({}, {});
 
-    for (auto v : m.verts) res.verts.push_back(v);
-    for (auto v : n.verts) res.verts.push_back(v);
+    auto size = (unsigned) std::min(m.inds.size(), n.inds.size());
+
+    res.verts.reserve(m.verts.size() + n.verts.size());
+    res.inds.reserve(size * (prim + 1));
+
+    res.verts.insert(res.verts.end(), m.verts.begin(), m.verts.end());
+    res.verts.insert(res.verts.end(), n.verts.begin(), n.verts.end());
 
     auto off = (unsigned) m.verts.size();
-    auto size = (int) std::min(m.inds.size(), n.inds.size());
 
-    for (int i = 0; i < size; i += prim) {
-        for (int j = 0; j < prim; ++j) {
-            for (int x = j; x < prim; ++x)
+    for (unsigned i = 0; i < size; i += prim) {
+        for (unsigned j = 0; j < prim; ++j) {
+            for (unsigned x = j; x < prim; ++x)
                 res.inds.push_back(m.inds[i + x]);
-            for (int x = 0; x <= j; ++x)
+            for (unsigned x = 0; x <= j; ++x)
                 res.inds.push_back(off + n.inds[i + x]);
         }
     }
@@ -117,7 +285,7 @@ Mesh<prim + 1> join(Mesh<prim> m, Mesh<prim> n) {
 }
 
 template<unsigned int prim>
-Mesh<prim + 1> joinCap(Mesh<prim> m, Mesh<prim> n) {
+Mesh<prim + 1> joinCap(const Mesh<prim> &m, const Mesh<prim> &n) {
     return concat(join(m, n), concat(fill(m), fill(n)));
 }
 
@@ -127,33 +295,415 @@ Mesh<prim + 1> thicken(const Mesh<prim> &m, glm::vec4 width) {
 }
 
 template<unsigned int prim>
-Mesh<prim> operator+(Mesh<prim> m, Mesh<prim> n) { return concat(m, n); }
+Mesh<prim> operator+(Mesh<prim> &&m, const Mesh<prim> &n) { return concat(std::move(m), n); }
 
 template<unsigned int prim>
-Mesh<prim> operator+(Mesh<prim> m, glm::vec4 off) { return offset(m, off); }
+Mesh<prim> operator+(const Mesh<prim> &m, const Mesh<prim> &n) { return concat(m, n); }
 
 template<unsigned int prim>
-Mesh<prim> operator-(Mesh<prim> m, glm::vec4 off) { return offset(m, -off); }
+Mesh<prim> operator+(Mesh<prim> &&m, glm::vec4 off) { return offset(std::move(m), off); }
 
 template<unsigned int prim>
-Mesh<prim> operator*(Mesh<prim> m, glm::vec4 scl) { return scale(m, scl); }
+Mesh<prim> operator+(const Mesh<prim> &m, glm::vec4 off) { return offset(m, off); }
 
 template<unsigned int prim>
-Mesh<prim> operator/(Mesh<prim> m, glm::vec4 scl) { return scale(m, 1.f / scl); }
+Mesh<prim> operator-(Mesh<prim> &&m, glm::vec4 off) { return offset(std::move(m), -off); }
 
 template<unsigned int prim>
-Mesh<prim> operator*(Mesh<prim> m, float scl) { return scale(m, scl); }
+Mesh<prim> operator-(const Mesh<prim> &m, glm::vec4 off) { return offset(m, -off); }
 
 template<unsigned int prim>
-Mesh<prim> operator/(Mesh<prim> m, float scl) { return scale(m, 1.f / scl); }
+Mesh<prim> operator*(Mesh<prim> &&m, glm::vec4 scl) { return scale(std::move(m), scl); }
 
 template<unsigned int prim>
-Mesh<prim> operator*(glm::mat4 mat, Mesh<prim> m) { return transform(m, mat); }
+Mesh<prim> operator*(const Mesh<prim> &m, glm::vec4 scl) { return scale(m, scl); }
 
 template<unsigned int prim>
-Mesh<prim> simplify(Mesh<prim> m) {
-    // todo remove redundant vertices and primitives
-    return Mesh<prim>({}, {});
+Mesh<prim> operator/(Mesh<prim> &&m, glm::vec4 scl) { return scale(std::move(m), 1.f / scl); }
+
+template<unsigned int prim>
+Mesh<prim> operator/(const Mesh<prim> &m, glm::vec4 scl) { return scale(m, 1.f / scl); }
+
+template<unsigned int prim>
+Mesh<prim> operator*(Mesh<prim> &&m, float scl) { return scale(std::move(m), scl); }
+
+template<unsigned int prim>
+Mesh<prim> operator*(const Mesh<prim> &m, float scl) { return scale(m, scl); }
+
+template<unsigned int prim>
+Mesh<prim> operator/(Mesh<prim> &&m, float scl) { return scale(std::move(m), 1.f / scl); }
+
+template<unsigned int prim>
+Mesh<prim> operator/(const Mesh<prim> &m, float scl) { return scale(m, 1.f / scl); }
+
+template<unsigned int prim>
+Mesh<prim> operator*(const glm::mat4 &mat, Mesh<prim> &&m) { return transform(std::move(m), mat); }
+
+template<unsigned int prim>
+Mesh<prim> operator*(const glm::mat4 &mat, const Mesh<prim> &m) { return transform(m, mat); }
+
+/*
+ * Lazy mesh expressions. `lazy(m)` wraps a mesh without copying it; `*`, `+`,
+ * `-`, `/`, `offset`, `scale`, and `transform` on expressions only build a
+ * small node tree, with consecutive affine maps folded into a single matrix
+ * and offset. The tree is materialized in one pass, writing every output
+ * vertex exactly once, when it is converted to a Mesh.
+ *
+ * Every node knows its output size up front, so each branch of a sum also
+ * knows where its output starts. Large trees are therefore written in
+ * parallel: the two sides of every sum run as separate tasks, and large
+ * leaves are split into chunks.
+ *
+ * Leaves hold pointers to their meshes, so an expression must not outlive
+ * the meshes it was built from.
+ */
+
+template<typename E, unsigned int prim>
+struct MeshExpr {
+    const E &self() const { return static_cast<const E &>(*this); }
+
+    Mesh<prim> evalSerial() const {
+        Mesh<prim> res({}, {});
+        res.verts.resize(self().vertCount());
+        res.inds.resize(self().indCount());
+
+        glm::vec4 *verts = res.verts.data();
+        unsigned *inds = res.inds.data();
+        unsigned base = 0;
+
+        self().write(verts, inds, base, glm::mat4(1), glm::vec4(0));
+
+        return res;
+    }
+
+    Mesh<prim> eval() const {
+        if (self().vertCount() + self().indCount() < detail::grain) return evalSerial();
+
+        Mesh<prim> res({}, {});
+        res.verts.resize(self().vertCount());
+        res.inds.resize(self().indCount());
+
+        TaskGroup group;
+        self().writeAt(group, res.verts.data(), res.inds.data(), 0, glm::mat4(1), glm::vec4(0));
+        group.wait();
+
+        return res;
+    }
+
+    operator Mesh<prim>() const { return eval(); }
+};
+
+template<typename E, unsigned int prim>
+struct MeshAffine : public MeshExpr<MeshAffine<E, prim>, prim> {
+    E expr;
+    glm::mat4 mat;
+    glm::vec4 off;
+
+    MeshAffine(E expr, const glm::mat4 &mat, glm::vec4 off)
+        : expr(std::move(expr)), mat(mat), off(off) {}
+
+    size_t vertCount() const { return expr.vertCount(); }
+
+    size_t indCount() const { return expr.indCount(); }
+
+    MeshAffine<E, prim> affine(const glm::mat4 &m, glm::vec4 o) const {
+        return MeshAffine<E, prim>(expr, m * mat, m * off + o);
+    }
+
+    void write(glm::vec4 *&verts, unsigned *&inds, unsigned &base,
+        const glm::mat4 &m, glm::vec4 o) const {
+        expr.write(verts, inds, base, m * mat, m * off + o);
+    }
+
+    void writeAt(TaskGroup &group, glm::vec4 *verts, unsigned *inds, unsigned base,
+        const glm::mat4 &m, glm::vec4 o) const {
+        expr.writeAt(group, verts, inds, base, m * mat, m * off + o);
+    }
+};
+
+template<unsigned int prim>
+struct MeshLeaf : public MeshExpr<MeshLeaf<prim>, prim> {
+    const Mesh<prim> *mesh;
+
+    explicit MeshLeaf(const Mesh<prim> &mesh) : mesh(&mesh) {}
+
+    size_t vertCount() const { return mesh->verts.size(); }
+
+    size_t indCount() const { return mesh->inds.size(); }
+
+    MeshAffine<MeshLeaf<prim>, prim> affine(const glm::mat4 &m, glm::vec4 o) const {
+        return MeshAffine<MeshLeaf<prim>, prim>(*this, m, o);
+    }
+
+    void write(glm::vec4 *&verts, unsigned *&inds, unsigned &base,
+        const glm::mat4 &m, glm::vec4 o) const {
+        for (const auto &vert : mesh->verts) *verts++ = m * vert + o;
+        for (auto i : mesh->inds) *inds++ = base + i;
+        base += (unsigned) mesh->verts.size();
+    }
+
+    void writeAt(TaskGroup &group, glm::vec4 *verts, unsigned *inds, unsigned base,
+        const glm::mat4 &m, glm::vec4 o) const {
+        const glm::vec4 *src_verts = mesh->verts.data();
+        const unsigned *src_inds = mesh->inds.data();
+
+        for (size_t lo = 0; lo < mesh->verts.size(); lo += detail::grain) {
+            size_t hi = std::min(mesh->verts.size(), lo + detail::grain);
+            group.run([=] { for (size_t i = lo; i < hi; ++i) verts[i] = m * src_verts[i] + o; });
+        }
+
+        for (size_t lo = 0; lo < mesh->inds.size(); lo += detail::grain) {
+            size_t hi = std::min(mesh->inds.size(), lo + detail::grain);
+            group.run([=] { for (size_t i = lo; i < hi; ++i) inds[i] = base + src_inds[i]; });
+        }
+    }
+};
+
+template<typename A, typename B, unsigned int prim>
+struct MeshSum : public MeshExpr<MeshSum<A, B, prim>, prim> {
+    A a;
+    B b;
+
+    MeshSum(A a, B b) : a(std::move(a)), b(std::move(b)) {}
+
+    size_t vertCount() const { return a.vertCount() + b.vertCount(); }
+
+    size_t indCount() const { return a.indCount() + b.indCount(); }
+
+    MeshAffine<MeshSum<A, B, prim>, prim> affine(const glm::mat4 &m, glm::vec4 o) const {
+        return MeshAffine<MeshSum<A, B, prim>, prim>(*this, m, o);
+    }
+
+    void write(glm::vec4 *&verts, unsigned *&inds, unsigned &base,
+        const glm::mat4 &m, glm::vec4 o) const {
+        a.write(verts, inds, base, m, o);
+        b.write(verts, inds, base, m, o);
+    }
+
+    void writeAt(TaskGroup &group, glm::vec4 *verts, unsigned *inds, unsigned base,
+        const glm::mat4 &m, glm::vec4 o) const {
+        group.run([=, &group] { a.writeAt(group, verts, inds, base, m, o); });
+        b.writeAt(group, verts + a.vertCount(), inds + a.indCount(), base + (unsigned) a.vertCount(), m, o);
+    }
+};
+
+template<unsigned int prim>
+MeshLeaf<prim> lazy(const Mesh<prim> &m) { return MeshLeaf<prim>(m); }
+
+template<typename E, unsigned int prim>
+auto transform(const MeshExpr<E, prim> &e, const glm::mat4 &mat) {
+    return e.self().affine(mat, glm::vec4(0));
+}
+
+template<typename E, unsigned int prim>
+auto offset(const MeshExpr<E, prim> &e, glm::vec4 off) {
+    return e.self().affine(glm::mat4(1), off);
+}
+
+template<typename E, unsigned int prim>
+auto scale(const MeshExpr<E, prim> &e, glm::vec4 scl) {
+    glm::mat4 mat(1);
+    for (int i = 0; i < 4; ++i) mat[i][i] = scl[i];
+    return e.self().affine(mat, glm::vec4(0));
+}
+
+template<typename E, unsigned int prim>
+auto scale(const MeshExpr<E, prim> &e, float scl) { return scale(e, glm::vec4(scl)); }
+
+template<typename A, typename B, unsigned int prim>
+MeshSum<A, B, prim> operator+(const MeshExpr<A, prim> &a, const MeshExpr<B, prim> &b) {
+    return MeshSum<A, B, prim>(a.self(), b.self());
+}
+
+template<typename E, unsigned int prim>
+auto operator+(const MeshExpr<E, prim> &e, glm::vec4 off) { return offset(e, off); }
+
+template<typename E, unsigned int prim>
+auto operator-(const MeshExpr<E, prim> &e, glm::vec4 off) { return offset(e, -off); }
+
+template<typename E, unsigned int prim>
+auto operator*(const MeshExpr<E, prim> &e, glm::vec4 scl) { return scale(e, scl); }
+
+template<typename E, unsigned int prim>
+auto operator/(const MeshExpr<E, prim> &e, glm::vec4 scl) { return scale(e, 1.f / scl); }
+
+template<typename E, unsigned int prim>
+auto operator*(const MeshExpr<E, prim> &e, float scl) { return scale(e, scl); }
+
+template<typename E, unsigned int prim>
+auto operator/(const MeshExpr<E, prim> &e, float scl) { return scale(e, 1.f / scl); }
+
+template<typename E, unsigned int prim>
+auto operator*(const glm::mat4 &mat, const MeshExpr<E, prim> &e) { return transform(e, mat); }
+
+struct SimplifyStats {
+    unsigned verts_before, verts_after;
+    unsigned prims_before, prims_after;
+};
+
+namespace detail {
+    template<typename T, size_t N>
+    struct ArrayHash {
+        size_t operator()(const std::array<T, N> &a) const {
+            size_t h = 0xcbf29ce484222325ull;
+            for (const auto &e : a) h = (h ^ (size_t) e) * 0x100000001b3ull;
+            return h;
+        }
+    };
+
+    /// the grid cell of x, clamped so that its neighbours cannot overflow
+    inline int64_t gridCell(float x, float eps) {
+        const double limit = (double) (1ll << 62);
+        double c = std::floor((double) x / eps);
+        if (!(c > -limit)) return -(1ll << 62);
+        if (!(c < limit)) return 1ll << 62;
+        return (int64_t) c;
+    }
+
+    /// the bits of x, with -0 folded into 0
+    inline int64_t floatBits(float x) {
+        x += 0.f;
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+}
+
+/*
+ * Welds vertices closer than `eps` (per component) using a hashed grid of
+ * `eps`-sized cells, then drops primitives that became degenerate or that
+ * duplicate an earlier primitive up to vertex order. Unreferenced vertices
+ * are discarded. An `eps` that is not positive welds only equal vertices.
+ * The grid and the other scratch tables allocate from the mesh resource
+ * too, so in a MeshArena their nodes cost no heap calls.
+ */
+template<unsigned int prim>
+Mesh<prim> simplify(const Mesh<prim> &m, float eps = 1e-4f, SimplifyStats *stats = nullptr) {
+    using Cell = std::array<int64_t, 4>;
+    auto *resource = detail::meshResource();
+
+    // equal vertices share their exact coordinates as a cell, and need no neighbours
+    bool exact = !(eps > 0);
+    int neighbours = exact ? 1 : 81;
+    float tol = exact ? 0 : eps;
+
+    std::pmr::unordered_map<Cell, std::pmr::vector<unsigned>, detail::ArrayHash<int64_t, 4>> grid(resource);
+    std::pmr::vector<glm::vec4> welded(resource);
+    std::pmr::vector<unsigned> remap(m.verts.size(), resource);
+
+    grid.reserve(m.verts.size());
+
+    for (unsigned i = 0; i < m.verts.size(); ++i) {
+        const auto &v = m.verts[i];
+        Cell cell;
+        for (int k = 0; k < 4; ++k) cell[k] = exact ? detail::floatBits(v[k]) : detail::gridCell(v[k], eps);
+
+        auto found = (unsigned) -1;
+        for (int n = 0; n < neighbours && found == (unsigned) -1; ++n) {
+            Cell near = cell;
+            if (!exact)
+                for (int k = 0, d = n; k < 4; ++k, d /= 3) near[k] += d % 3 - 1;
+
+            auto it = grid.find(near);
+            if (it == grid.end()) continue;
+
+            for (auto j : it->second) {
+                auto diff = welded[j] - v;
+                float dist = 0;
+                for (int k = 0; k < 4; ++k) dist = std::max(dist, std::abs(diff[k]));
+
+                if (dist <= tol) {
+                    found = j;
+                    break;
+                }
+            }
+        }
+
+        if (found == (unsigned) -1) {
+            found = (unsigned) welded.size();
+            welded.push_back(v);
+            grid[cell].push_back(found);
+        }
+
+        remap[i] = found;
+    }
+
+    using Key = std::array<unsigned, prim>;
+    std::pmr::unordered_set<Key, detail::ArrayHash<unsigned, prim>> seen(resource);
+    std::pmr::vector<unsigned> used(welded.size(), (unsigned) -1, resource);
+
+    Mesh<prim> res({}, {});
+    res.inds.reserve(m.inds.size());
+
+    for (unsigned i = 0; i < m.size(); ++i) {
+        Key key;
+        for (unsigned j = 0; j < prim; ++j) key[j] = remap[m.inds[i * prim + j]];
+        Key prm = key;
+
+        std::sort(key.begin(), key.end());
+        if (std::adjacent_find(key.begin(), key.end()) != key.end()) continue;
+        if (!seen.insert(key).second) continue;
+
+        for (auto v : prm) {
+            if (used[v] == (unsigned) -1) {
+                used[v] = (unsigned) res.verts.size();
+                res.verts.push_back(welded[v]);
+            }
+            res.inds.push_back(used[v]);
+        }
+    }
+
+    if (stats) {
+        *stats = {
+            (unsigned) m.verts.size(), (unsigned) res.verts.size(),
+            m.size(), res.size(),
+        };
+    }
+
+    return res;
+}
+
+/*
+ * Appends every distinct edge of the primitives' simplices to `inds` as an
+ * index pair, lower index first, in order of first appearance. Edges shared
+ * by neighbouring primitives appear once, so the pairs can be drawn as
+ * GL_LINES with each line rasterized once.
+ */
+template<unsigned int prim, typename Inds>
+void edgeIndices(const Mesh<prim> &m, Inds &inds) {
+    std::unordered_set<uint64_t> seen;
+    seen.reserve(m.inds.size());
+    inds.reserve(inds.size() + m.inds.size());
+
+    for (unsigned p = 0; p < m.size(); ++p) {
+        const unsigned *ind = &m.inds[p * prim];
+
+        for (unsigned i = 0; i < prim; ++i) {
+            for (unsigned j = i + 1; j < prim; ++j) {
+                unsigned a = std::min(ind[i], ind[j]);
+                unsigned b = std::max(ind[i], ind[j]);
+                if (a == b || !seen.insert((uint64_t) a << 32 | b).second) continue;
+
+                inds.push_back(a);
+                inds.push_back(b);
+            }
+        }
+    }
+}
+
+/// only the index pairs of edges(), for drawing with the vertices already uploaded
+template<unsigned int prim>
+std::vector<unsigned> edgeIndices(const Mesh<prim> &m) {
+    std::vector<unsigned> inds;
+    edgeIndices(m, inds);
+    return inds;
+}
+
+template<unsigned int prim>
+Mesh<2> edges(const Mesh<prim> &m) {
+    Mesh<2> res(m.verts, {});
+    edgeIndices(m, res.inds);
+    return res;
 }
 
 #endif //SIMPLEX_MESH_H
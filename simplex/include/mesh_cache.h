@@ -0,0 +1,284 @@
+#ifndef SIMPLEX_MESH_CACHE_H
+#define SIMPLEX_MESH_CACHE_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "mesh.h"
+
+/*
+ * Binary Mesh<prim> files: a fixed header followed by the vertex block and
+ * the index block, each starting on a 64-byte boundary. Files are mapped
+ * read-only and the blocks can be handed to glBufferData as they are.
+ */
+
+const char MESH_FILE_MAGIC[4] = {'S', 'M', 'S', 'H'};
+const uint32_t MESH_FILE_VERSION = 1;
+
+/*
+ * Salt for every cache key. Bump it whenever a change to the generators
+ * (solids.h, the combinators, simplify(), layout.h, ...) changes the meshes
+ * they produce, just as MESH_FILE_VERSION is bumped when the file layout
+ * changes; files written under another salt are then rebuilt.
+ */
+const uint32_t MESH_GENERATOR_VERSION = 1;
+const uint64_t MESH_FILE_ALIGN = MESH_ALIGN;
+
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t prim;
+    uint32_t generator;
+    uint64_t vert_count, ind_count;
+    uint64_t vert_offset, ind_offset;
+    uint64_t checksum;
+};
+
+namespace detail {
+    inline uint64_t alignUp(uint64_t n) {
+        return (n + MESH_FILE_ALIGN - 1) / MESH_FILE_ALIGN * MESH_FILE_ALIGN;
+    }
+
+    /// FNV-1a over 8-byte words, with the tail folded in bytewise
+    inline uint64_t checksum(const void *data, size_t size, uint64_t h = 0xcbf29ce484222325ull) {
+        auto *bytes = (const unsigned char *) data;
+        size_t words = size / 8;
+
+        for (size_t i = 0; i < words; ++i) {
+            uint64_t w;
+            memcpy(&w, bytes + i * 8, 8);
+            h = (h ^ w) * 0x100000001b3ull;
+        }
+        for (size_t i = words * 8; i < size; ++i)
+            h = (h ^ bytes[i]) * 0x100000001b3ull;
+
+        return h;
+    }
+}
+
+/*
+ * A read-only mesh backed by a mapped mesh file or, when the file could not
+ * be written, by an owned CompactMesh.
+ */
+template<unsigned int prim>
+class MappedMesh {
+    void *_data = nullptr;
+    size_t _size = 0;
+
+    CompactMesh<prim> _owned;
+
+    const glm::vec4 *_verts = nullptr;
+    const unsigned *_inds = nullptr;
+    size_t _vert_count = 0, _ind_count = 0;
+
+    void reset() {
+        if (_data) munmap(_data, _size);
+        _data = nullptr;
+        _size = 0;
+        _owned = CompactMesh<prim>();
+        _verts = nullptr;
+        _inds = nullptr;
+        _vert_count = _ind_count = 0;
+    }
+
+public:
+    MappedMesh() = default;
+
+    MappedMesh(const MappedMesh &) = delete;
+
+    MappedMesh &operator=(const MappedMesh &) = delete;
+
+    MappedMesh(MappedMesh &&other) noexcept { *this = std::move(other); }
+
+    MappedMesh &operator=(MappedMesh &&other) noexcept {
+        reset();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_owned, other._owned);
+        std::swap(_verts, other._verts);
+        std::swap(_inds, other._inds);
+        std::swap(_vert_count, other._vert_count);
+        std::swap(_ind_count, other._ind_count);
+        return *this;
+    }
+
+    ~MappedMesh() { reset(); }
+
+    /// maps `path`, rejecting files with the wrong magic, version, generator, prim, layout, or checksum
+    bool open(const std::string &path, bool verify = true) {
+        reset();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(MeshFileHeader)) {
+            ::close(fd);
+            return false;
+        }
+
+        _size = (size_t) st.st_size;
+        _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            _size = 0;
+            return false;
+        }
+
+        const auto *header = (const MeshFileHeader *) _data;
+
+        bool valid = memcmp(header->magic, MESH_FILE_MAGIC, 4) == 0 &&
+            header->version == MESH_FILE_VERSION &&
+            header->generator == MESH_GENERATOR_VERSION &&
+            header->prim == prim &&
+            header->vert_offset % MESH_FILE_ALIGN == 0 &&
+            header->ind_offset % MESH_FILE_ALIGN == 0 &&
+            // written so that corrupt counts cannot wrap around
+            header->vert_offset <= _size &&
+            header->vert_count <= (_size - header->vert_offset) / sizeof(glm::vec4) &&
+            header->ind_offset <= _size &&
+            header->ind_count <= (_size - header->ind_offset) / sizeof(unsigned) &&
+            header->ind_count % prim == 0;
+
+        if (valid) {
+            _verts = (const glm::vec4 *) ((const char *) _data + header->vert_offset);
+            _inds = (const unsigned *) ((const char *) _data + header->ind_offset);
+            _vert_count = (size_t) header->vert_count;
+            _ind_count = (size_t) header->ind_count;
+        }
+
+        if (valid && verify) {
+            auto h = detail::checksum(_verts, _vert_count * sizeof(glm::vec4));
+            h = detail::checksum(_inds, _ind_count * sizeof(unsigned), h);
+            valid = h == header->checksum;
+        }
+
+        if (!valid) reset();
+        return valid;
+    }
+
+    /// takes ownership of an in-memory mesh instead of a mapping
+    void adopt(CompactMesh<prim> m) {
+        reset();
+        _owned = std::move(m);
+        _verts = _owned.verts();
+        _inds = _owned.inds();
+        _vert_count = _owned.vertCount();
+        _ind_count = _owned.indCount();
+    }
+
+    bool isMapped() const { return _data != nullptr; }
+
+    const glm::vec4 *verts() const { return _verts; }
+
+    const unsigned *inds() const { return _inds; }
+
+    size_t vertCount() const { return _vert_count; }
+
+    size_t indCount() const { return _ind_count; }
+
+    unsigned size() const { return (unsigned) (_ind_count / prim); }
+
+    /// an owning copy, for code that needs the mesh on the CPU side
+    Mesh<prim> mesh() const {
+        Mesh<prim> res({}, {});
+        res.verts.assign(_verts, _verts + _vert_count);
+        res.inds.assign(_inds, _inds + _ind_count);
+        return res;
+    }
+};
+
+/// writes `m` to `path` through a temporary file, so readers never see a partial file
+template<unsigned int prim>
+bool saveMesh(const std::string &path, const Mesh<prim> &m) {
+    MeshFileHeader header{};
+    memcpy(header.magic, MESH_FILE_MAGIC, 4);
+    header.version = MESH_FILE_VERSION;
+    header.generator = MESH_GENERATOR_VERSION;
+    header.prim = prim;
+    header.vert_count = m.verts.size();
+    header.ind_count = m.inds.size();
+    header.vert_offset = detail::alignUp(sizeof(MeshFileHeader));
+    header.ind_offset = detail::alignUp(header.vert_offset + m.verts.size() * sizeof(glm::vec4));
+    header.checksum = detail::checksum(
+        m.inds.data(), m.inds.size() * sizeof(unsigned),
+        detail::checksum(m.verts.data(), m.verts.size() * sizeof(glm::vec4)));
+
+    auto tmp = path + ".tmp";
+    FILE *file = fopen(tmp.c_str(), "wb");
+    if (!file) return false;
+
+    const char zeros[MESH_FILE_ALIGN] = {};
+    auto pad = [&](uint64_t to) { fwrite(zeros, 1, (size_t) (to - (uint64_t) ftell(file)), file); };
+
+    fwrite(&header, sizeof(header), 1, file);
+    pad(header.vert_offset);
+    fwrite(m.verts.data(), sizeof(glm::vec4), m.verts.size(), file);
+    pad(header.ind_offset);
+    fwrite(m.inds.data(), sizeof(unsigned), m.inds.size(), file);
+
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/// directory for cached meshes: $SIMPLEX_CACHE_DIR, or ./cache
+inline std::string meshCacheDir() {
+    const char *dir = getenv("SIMPLEX_CACHE_DIR");
+    return dir && *dir ? std::string(dir) : std::string("cache");
+}
+
+/// where the mesh cached under `key` is stored
+inline std::string meshCachePath(const std::string &key) {
+    std::string name;
+    for (char c : key) name += isalnum((unsigned char) c) || c == '.' || c == '-' ? c : '_';
+
+    return meshCacheDir() + "/" + name + ".mesh";
+}
+
+/*
+ * Maps the mesh cached under `key`, generating and storing it first if it is
+ * missing or stale. The key should spell out the generator and all of its
+ * parameters; edits to the generator's code bump MESH_GENERATOR_VERSION
+ * instead of changing the key. The generator runs in a MeshArena, and only
+ * the saved file or a compacted copy outlives it.
+ */
+template<unsigned int prim, typename Generator>
+MappedMesh<prim> cachedMesh(const std::string &key, Generator generate) {
+    auto dir = meshCacheDir();
+    auto path = meshCachePath(key);
+
+    MappedMesh<prim> mapped;
+    if (mapped.open(path)) return mapped;
+
+    MeshArena arena;
+    Mesh<prim> m = generate();
+
+    mkdir(dir.c_str(), 0755);
+    if (!saveMesh(path, m) || !mapped.open(path)) {
+        fprintf(stderr, "Cannot cache mesh %s at %s\n", key.c_str(), path.c_str());
+        mapped.adopt(compact(m));
+    }
+
+    return mapped;
+}
+
+#endif //SIMPLEX_MESH_CACHE_H
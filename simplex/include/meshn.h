@@ -0,0 +1,218 @@
+#ifndef SIMPLEX_MESHN_H
+#define SIMPLEX_MESHN_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec4.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "mesh.h"
+
+/*
+ * Meshes of any small dimension. Vertices are fixed-size float arrays
+ * stored contiguously, so a MeshN<5, 5> is one flat block of 5-float
+ * records, with no padding to a vector type. Matrices are column-major like
+ * glm: `m[col][row]`.
+ *
+ * The generators produce closed boundaries as (dim - 1)-simplices, which
+ * is what SlicerN cuts down one dimension at a time.
+ */
+template<std::size_t dim>
+using VecN = std::array<float, dim>;
+
+template<std::size_t dim>
+using MatN = std::array<VecN<dim>, dim>;
+
+template<std::size_t dim, unsigned prim>
+struct MeshN {
+    std::vector<VecN<dim>> verts;
+    std::vector<unsigned> inds;
+
+    unsigned size() const {
+        return (unsigned) inds.size() / prim;
+    }
+};
+
+template<std::size_t dim>
+MatN<dim> identityN() {
+    MatN<dim> res{};
+    for (unsigned i = 0; i < dim; ++i) res[i][i] = 1;
+    return res;
+}
+
+/// rotation in the plane of axes i and j, turning e_i towards e_j
+template<std::size_t dim>
+MatN<dim> rotN(unsigned i, unsigned j, float angle) {
+    auto res = identityN<dim>();
+    float c = std::cos(angle), s = std::sin(angle);
+    res[i][i] = c;
+    res[i][j] = s;
+    res[j][i] = -s;
+    res[j][j] = c;
+    return res;
+}
+
+template<std::size_t dim>
+MatN<dim> operator*(const MatN<dim> &a, const MatN<dim> &b) {
+    MatN<dim> res{};
+    for (unsigned c = 0; c < dim; ++c)
+        for (unsigned k = 0; k < dim; ++k)
+            for (unsigned r = 0; r < dim; ++r)
+                res[c][r] += a[k][r] * b[c][k];
+    return res;
+}
+
+/// `v -> mat * v + off` for every vertex
+template<std::size_t dim, unsigned prim>
+MeshN<dim, prim> transform(MeshN<dim, prim> &&m, const MatN<dim> &mat, const VecN<dim> &off) {
+    for (auto &v : m.verts) {
+        VecN<dim> res = off;
+        for (unsigned c = 0; c < dim; ++c)
+            for (unsigned r = 0; r < dim; ++r)
+                res[r] += mat[c][r] * v[c];
+        v = res;
+    }
+    return std::move(m);
+}
+
+template<std::size_t dim, unsigned prim>
+MeshN<dim, prim> transform(const MeshN<dim, prim> &m, const MatN<dim> &mat, const VecN<dim> &off) {
+    return transform(MeshN<dim, prim>(m), mat, off);
+}
+
+template<unsigned prim>
+MeshN<4, prim> toMeshN(const Mesh<prim> &m) {
+    MeshN<4, prim> res{{}, {m.inds.begin(), m.inds.end()}};
+    res.verts.reserve(m.verts.size());
+    for (const auto &v : m.verts) res.verts.push_back({v.x, v.y, v.z, v.w});
+    return res;
+}
+
+template<unsigned prim>
+Mesh<prim> toMesh(const MeshN<4, prim> &m) {
+    Mesh<prim> res({}, {});
+    res.inds.assign(m.inds.begin(), m.inds.end());
+    res.verts.reserve(m.verts.size());
+    for (const auto &v : m.verts) res.verts.emplace_back(v[0], v[1], v[2], v[3]);
+    return res;
+}
+
+/// unindexed triangles as vec4(x, y, z, 0), the layout of the Section buffer
+std::vector<glm::vec4> triangles(const MeshN<3, 3> &m) {
+    std::vector<glm::vec4> res;
+    res.reserve(m.inds.size());
+    for (auto i : m.inds) res.emplace_back(m.verts[i][0], m.verts[i][1], m.verts[i][2], 0);
+    return res;
+}
+
+/// closed regular polygon in the plane
+MeshN<2, 2> polygon(unsigned sides) {
+    MeshN<2, 2> res;
+
+    auto t = (float) (glm::pi<double>() * 2 / sides);
+    for (unsigned i = 0; i < sides; ++i) {
+        res.verts.push_back({std::cos(t * i), std::sin(t * i)});
+        res.inds.push_back(i);
+        res.inds.push_back((i + 1) % sides);
+    }
+
+    return res;
+}
+
+/*
+ * Boundary of [-1, 1]^dim. Vertex `b` has coordinate k at +1 where bit k of
+ * `b` is set. Each facet is split into (dim - 1)! simplices by the Kuhn
+ * triangulation: walk from the facet's lowest corner, raising one free axis
+ * at a time in every possible order. Neighbouring facets agree on their
+ * shared faces, so the boundary is closed.
+ */
+template<std::size_t dim>
+MeshN<dim, dim> hypercube() {
+    static_assert(dim >= 2 && dim < 32, "hypercube<dim> needs 2 <= dim < 32");
+
+    MeshN<dim, dim> res;
+
+    for (unsigned b = 0; b < (1u << dim); ++b) {
+        VecN<dim> v{};
+        for (unsigned k = 0; k < dim; ++k) v[k] = b & (1u << k) ? 1.f : -1.f;
+        res.verts.push_back(v);
+    }
+
+    for (unsigned axis = 0; axis < dim; ++axis) {
+        std::array<unsigned, dim - 1> free{};
+        for (unsigned k = 0, f = 0; k < dim; ++k)
+            if (k != axis) free[f++] = k;
+
+        for (unsigned side : {0u, 1u}) {
+            auto perm = free;
+            do {
+                unsigned b = side << axis;
+                res.inds.push_back(b);
+                for (auto k : perm) res.inds.push_back(b |= 1u << k);
+            } while (std::next_permutation(perm.begin(), perm.end()));
+        }
+    }
+
+    return res;
+}
+
+/// boundary of the regular simplex with circumradius 1, one facet opposite each vertex
+template<std::size_t dim>
+MeshN<dim, dim> simplex() {
+    static_assert(dim >= 2, "simplex<dim> needs dim >= 2");
+
+    MeshN<dim, dim> res;
+
+    // the basis vectors plus the point on the diagonal equidistant from all of them
+    float c = (1 - std::sqrt((float) dim + 1)) / dim;
+    for (unsigned i = 0; i <= dim; ++i) {
+        VecN<dim> v{};
+        for (unsigned k = 0; k < dim; ++k) v[k] = i == dim ? c : (float) (i == k);
+        res.verts.push_back(v);
+    }
+
+    VecN<dim> center{};
+    for (const auto &v : res.verts)
+        for (unsigned k = 0; k < dim; ++k) center[k] += v[k] / (dim + 1);
+
+    float radius = 0;
+    for (unsigned k = 0; k < dim; ++k) radius += (res.verts[0][k] - center[k]) * (res.verts[0][k] - center[k]);
+    radius = std::sqrt(radius);
+
+    for (auto &v : res.verts)
+        for (unsigned k = 0; k < dim; ++k) v[k] = (v[k] - center[k]) / radius;
+
+    for (unsigned skip = 0; skip <= dim; ++skip)
+        for (unsigned i = 0; i <= dim; ++i)
+            if (i != skip) res.inds.push_back(i);
+
+    return res;
+}
+
+/// boundary of the cross-polytope: vertices at +-e_k, one facet per choice of signs
+template<std::size_t dim>
+MeshN<dim, dim> orthoplex() {
+    static_assert(dim >= 2 && dim < 32, "orthoplex<dim> needs 2 <= dim < 32");
+
+    MeshN<dim, dim> res;
+
+    for (unsigned k = 0; k < dim; ++k) {
+        VecN<dim> v{};
+        v[k] = 1;
+        res.verts.push_back(v);
+        v[k] = -1;
+        res.verts.push_back(v);
+    }
+
+    for (unsigned signs = 0; signs < (1u << dim); ++signs)
+        for (unsigned k = 0; k < dim; ++k)
+            res.inds.push_back(2 * k + ((signs >> k) & 1));
+
+    return res;
+}
+
+#endif //SIMPLEX_MESHN_H
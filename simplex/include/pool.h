@@ -0,0 +1,248 @@
+#ifndef SIMPLEX_POOL_H
+#define SIMPLEX_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+ * its own work at the back (newest first, cache-warm), and when it runs dry
+ * it steals from the front of the other deques (oldest first, the biggest
+ * pieces of a recursive split). Tasks submitted from outside the pool are
+ * spread round-robin.
+ *
+ * Waiting never blocks a worker: TaskGroup::wait() keeps running queued tasks
+ * until its own have finished, so groups can nest freely.
+ */
+class ThreadPool {
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleep_mutex;
+    std::condition_variable sleep;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> next{0};
+    bool stopping = false;
+
+    struct Worker {
+        ThreadPool *pool;
+        int index;
+    };
+
+    static Worker &worker() {
+        thread_local Worker w{nullptr, -1};
+        return w;
+    }
+
+    /// index of the calling thread's queue, or -1 outside this pool
+    int index() const {
+        return worker().pool == this ? worker().index : -1;
+    }
+
+    bool pop(size_t q, bool back, std::function<void()> &task) {
+        auto &queue = *queues[q];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+
+        if (back) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        pending--;
+        return true;
+    }
+
+    void work(int index) {
+        worker() = {this, index};
+
+        while (true) {
+            if (runOne()) continue;
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep.wait(lock, [&] { return stopping || pending > 0; });
+            if (stopping && pending == 0) return;
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned count = std::thread::hardware_concurrency()) {
+        count = std::max(count, 1u);
+
+        for (unsigned i = 0; i < count; ++i)
+            queues.emplace_back(new Queue());
+
+        for (unsigned i = 0; i < count; ++i)
+            threads.emplace_back([this, i] { work((int) i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        sleep.notify_all();
+
+        for (auto &thread : threads) thread.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const { return threads.size(); }
+
+    void submit(std::function<void()> task) {
+        int own = index();
+        size_t q = own >= 0 ? (size_t) own : next++ % queues.size();
+
+        {
+            // counted before it can be popped, so pending never drops below zero
+            std::lock_guard<std::mutex> lock(queues[q]->mutex);
+            pending++;
+            queues[q]->tasks.push_back(std::move(task));
+        }
+
+        {
+            // pairs with the predicate check in work(), so the wakeup cannot be lost
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        sleep.notify_one();
+    }
+
+    /// runs one queued task, own queue first, then by stealing; false if there was none
+    bool runOne() {
+        std::function<void()> task;
+
+        int own = index();
+        size_t n = queues.size();
+        size_t start = own >= 0 ? (size_t) own : 0;
+
+        bool found = own >= 0 && pop((size_t) own, true, task);
+        for (size_t i = 1; !found && i <= n; ++i)
+            found = pop((start + i) % n, false, task);
+
+        if (!found) return false;
+
+        task();
+        return true;
+    }
+};
+
+/// the process-wide pool; SIMPLEX_THREADS overrides the hardware thread count
+inline ThreadPool &pool() {
+    static ThreadPool instance([] {
+        const char *env = std::getenv("SIMPLEX_THREADS");
+        int count = env ? std::atoi(env) : 0;
+        return count > 0 ? (unsigned) count : std::thread::hardware_concurrency();
+    }());
+    return instance;
+}
+
+/*
+ * A set of tasks to wait for together. Tasks may run more tasks in the same
+ * or in nested groups.
+ */
+class TaskGroup {
+    ThreadPool &_pool;
+    std::atomic<size_t> _running{0};
+
+public:
+    explicit TaskGroup(ThreadPool &pool = ::pool()) : _pool(pool) {}
+
+    ~TaskGroup() { wait(); }
+
+    template<typename F>
+    void run(F &&fn) {
+        _running++;
+        _pool.submit([this, fn = std::forward<F>(fn)]() mutable {
+            fn();
+            _running--;
+        });
+    }
+
+    void wait() {
+        while (_running > 0) {
+            if (!_pool.runOne()) std::this_thread::yield();
+        }
+    }
+};
+
+/// calls fn(lo, hi) over [begin, end) in chunks of about `grain`, in parallel
+template<typename F>
+void parallelFor(size_t begin, size_t end, size_t grain, const F &fn) {
+    grain = std::max<size_t>(grain, 1);
+    if (end - begin <= grain) {
+        if (begin < end) fn(begin, end);
+        return;
+    }
+
+    TaskGroup group;
+    for (size_t lo = begin; lo < end; lo += grain) {
+        size_t hi = std::min(end, lo + grain);
+        group.run([&fn, lo, hi] { fn(lo, hi); });
+    }
+    group.wait();
+}
+
+/*
+ * Exclusive prefix sum of `in` into `out` (which may alias `in`), returning
+ * the total. Blocks are summed in parallel, the block totals scanned
+ * serially, then each block is rescanned from its offset in parallel.
+ */
+template<typename T>
+T parallelScan(const std::vector<T> &in, std::vector<T> &out, size_t grain = 1u << 16) {
+    size_t n = in.size();
+    out.resize(n);
+    grain = std::max<size_t>(grain, 1);
+
+    size_t blocks = (n + grain - 1) / grain;
+    std::vector<T> sums(blocks);
+
+    parallelFor(0, blocks, 1, [&](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; ++b) {
+            T sum{};
+            for (size_t i = b * grain; i < std::min(n, (b + 1) * grain); ++i) sum += in[i];
+            sums[b] = sum;
+        }
+    });
+
+    T total{};
+    for (auto &sum : sums) {
+        T s = sum;
+        sum = total;
+        total += s;
+    }
+
+    parallelFor(0, blocks, 1, [&](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; ++b) {
+            T run = sums[b];
+            for (size_t i = b * grain; i < std::min(n, (b + 1) * grain); ++i) {
+                T v = in[i];
+                out[i] = run;
+                run += v;
+            }
+        }
+    });
+
+    return total;
+}
+
+#endif //SIMPLEX_POOL_H
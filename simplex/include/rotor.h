@@ -1,40 +1,65 @@
 #ifndef GL_TEMPLATE_ROTOR_H
 #define GL_TEMPLATE_ROTOR_H
 
+#include <cmath>
+
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include <vsr/vsr.h>
 
+/*
+ * Rotation by `angle` in the plane spanned by `u` and `v`, turning `u`
+ * towards `v`. This is the matrix of the rotor exp(-(u ^ v).unit() * angle / 2)
+ * written out in closed form: with `a`, `b` an orthonormal basis of the
+ * plane,
+ *
+ *     M = I + (cos - 1)(a a^T + b b^T) + sin (b a^T - a b^T)
+ *
+ * so no multivector temporaries are built.
+ */
 glm::mat4 rotor(glm::vec4 u, glm::vec4 v, float angle) {
-    using Vec = vsr::euclidean_vector<4, float>;
+    auto dot = [](const glm::vec4 &p, const glm::vec4 &q) {
+        return p.x * q.x + p.y * q.y + p.z * q.z + p.w * q.w;
+    };
 
-    auto eu = *((Vec *) (void *) &u);
-    auto ev = *((Vec *) (void *) &v);
+    glm::vec4 a = u / std::sqrt(dot(u, u));
+    glm::vec4 b = v - a * dot(v, a);
+    b = b / std::sqrt(dot(b, b));
 
-    auto biv = (eu ^ ev).unit() * angle / 2;
+    float c = std::cos(angle) - 1, s = std::sin(angle);
 
-    Vec col[4] = {
-        Vec(1, 0, 0, 0).rotate(biv),
-        Vec(0, 1, 0, 0).rotate(biv),
-        Vec(0, 0, 1, 0).rotate(biv),
-        Vec(0, 0, 0, 1).rotate(biv)
-    };
+    glm::mat4 res(1);
+    for (int col = 0; col < 4; ++col)
+        for (int row = 0; row < 4; ++row)
+            res[col][row] += c * (a[row] * a[col] + b[row] * b[col]) + s * (b[row] * a[col] - a[row] * b[col]);
+
+    return res;
+}
+
+/// rotation in the plane of basis vectors `i` and `j`, turning e_i towards e_j; only four entries differ from I
+template<int i, int j>
+glm::mat4 rot(float angle) {
+    static_assert(0 <= i && i < 4 && 0 <= j && j < 4 && i != j, "rot<i, j> needs two distinct axes");
+
+    float c = std::cos(angle), s = std::sin(angle);
 
-    return glm::make_mat4((float *) col);
+    glm::mat4 res(1);
+    res[i][i] = c;
+    res[i][j] = s;
+    res[j][i] = -s;
+    res[j][j] = c;
+    return res;
 }
 
-glm::mat4 rot_xy(float angle) { return rotor(glm::vec4(1, 0, 0, 0), glm::vec4(0, 1, 0, 0), angle); }
+glm::mat4 rot_xy(float angle) { return rot<0, 1>(angle); }
 
-glm::mat4 rot_xz(float angle) { return rotor(glm::vec4(1, 0, 0, 0), glm::vec4(0, 0, 1, 0), angle); }
+glm::mat4 rot_xz(float angle) { return rot<0, 2>(angle); }
 
-glm::mat4 rot_xw(float angle) { return rotor(glm::vec4(1, 0, 0, 0), glm::vec4(0, 0, 0, 1), angle); }
+glm::mat4 rot_xw(float angle) { return rot<0, 3>(angle); }
 
-glm::mat4 rot_yz(float angle) { return rotor(glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0), angle); }
+glm::mat4 rot_yz(float angle) { return rot<1, 2>(angle); }
 
-glm::mat4 rot_yw(float angle) { return rotor(glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 0, 1), angle); }
+glm::mat4 rot_yw(float angle) { return rot<1, 3>(angle); }
 
-glm::mat4 rot_zw(float angle) { return rotor(glm::vec4(0, 0, 1, 0), glm::vec4(0, 0, 0, 1), angle); }
+glm::mat4 rot_zw(float angle) { return rot<2, 3>(angle); }
 
 #endif //GL_TEMPLATE_ROTOR_H
@@ -0,0 +1,386 @@
+#ifndef SIMPLEX_SCENE_H
+#define SIMPLEX_SCENE_H
+
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <gl_util.h>
+
+#include "mesh.h"
+
+/*
+ * First-fit allocator over the index range [0, capacity). Free ranges are
+ * kept sorted by offset and coalesced with their neighbours on release, so
+ * meshes of different sizes can come and go without fragmenting the shared
+ * buffers more than necessary.
+ */
+class RangeAllocator {
+    /// offset -> size of each free range
+    std::map<unsigned, unsigned> _free;
+    unsigned _capacity = 0;
+
+public:
+    static constexpr unsigned npos = ~0u;
+
+    explicit RangeAllocator(unsigned capacity = 0) { grow(capacity); }
+
+    unsigned capacity() const { return _capacity; }
+
+    /// returns the offset of `n` contiguous units, or npos if no free range is large enough
+    unsigned allocate(unsigned n) {
+        if (n == 0) return 0;
+
+        for (auto it = _free.begin(); it != _free.end(); ++it) {
+            if (it->second < n) continue;
+
+            unsigned first = it->first, size = it->second;
+            _free.erase(it);
+            if (size > n) _free.emplace(first + n, size - n);
+            return first;
+        }
+
+        return npos;
+    }
+
+    void release(unsigned first, unsigned n) {
+        if (n == 0) return;
+
+        auto it = _free.emplace(first, n).first;
+
+        auto next = std::next(it);
+        if (next != _free.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            _free.erase(next);
+        }
+
+        if (it != _free.begin()) {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first) {
+                prev->second += it->second;
+                _free.erase(it);
+            }
+        }
+    }
+
+    /// extends the range; the new tail is free
+    void grow(unsigned capacity) {
+        if (capacity <= _capacity) return;
+
+        unsigned old = _capacity;
+        _capacity = capacity;
+        release(old, capacity - old);
+    }
+};
+
+/*
+ * Many independently transformed objects drawn with one call. Meshes are
+ * sub-allocated from one shared vertex SSBO and one cell buffer; objects
+ * reference a mesh and carry an Instance transform in an SSBO. Each object
+ * is one glMultiDrawArraysIndirect command whose base instance is its slot in
+ * that table, which the divisor-1 `vInst` attribute passes to the shaders.
+ *
+ * Cell indices are rebased to the mesh's vertex range on upload, since array
+ * draws have no base vertex.
+ *
+ * The command buffer holds the command list twice: as is, and with the
+ * counts of hidden objects zeroed, so one pass can skip objects that
+ * another still draws.
+ */
+class Scene {
+    struct MeshRange {
+        unsigned first_vert, vert_count;
+        unsigned first_cell, cell_count;
+    };
+
+    RangeAllocator _vert_alloc, _cell_alloc;
+    std::vector<MeshRange> _meshes;
+    std::vector<unsigned> _free_meshes;
+
+    /// dense per-slot data; slots are compacted on removal
+    std::vector<Instance> _instances;
+    std::vector<util::DrawArraysIndirectCommand> _commands, _visible;
+    std::vector<uint8_t> _hidden;
+    std::vector<unsigned> _slot_object;
+
+    /// object id -> slot, or npos once removed
+    std::vector<unsigned> _object_slot;
+    std::vector<unsigned> _free_objects;
+
+    bool _dirty = false;
+
+    GLuint _ind_loc = 0, _inst_loc = 0;
+    GLuint _array = 0;
+    GLuint _vert_buf = 0, _cell_buf = 0;
+    GLuint _inst_buf = 0, _inst_id_buf = 0, _cmd_buf = 0;
+    unsigned _inst_capacity = 0, _cmd_capacity = 0;
+
+    static constexpr unsigned npos = ~0u;
+
+    /// reallocates `buf` at `size` bytes, keeping the first `keep` bytes
+    static void resize(GLuint &buf, GLsizeiptr keep, GLsizeiptr size, GLenum usage) {
+        GLuint next;
+        glGenBuffers(1, &next);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, next);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, usage);
+
+        if (buf && keep) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buf);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keep);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (buf) glDeleteBuffers(1, &buf);
+        buf = next;
+    }
+
+    /// allocates from `alloc`, doubling the backing buffer when it is full
+    static unsigned allocate(RangeAllocator &alloc, unsigned n, GLuint &buf, GLsizeiptr stride) {
+        unsigned first = alloc.allocate(n);
+        if (first != RangeAllocator::npos) return first;
+
+        unsigned old = alloc.capacity();
+        unsigned capacity = std::max(old * 2, old + n);
+        resize(buf, old * stride, capacity * stride, GL_STATIC_DRAW);
+        alloc.grow(capacity);
+
+        return alloc.allocate(n);
+    }
+
+    void bindArray() {
+        glBindVertexArray(_array);
+
+        glBindBuffer(GL_ARRAY_BUFFER, _cell_buf);
+        glEnableVertexAttribArray(_ind_loc);
+        glVertexAttribIPointer(_ind_loc, 4, GL_UNSIGNED_INT, sizeof(int) * 4, (void *) nullptr);
+
+        glBindBuffer(GL_ARRAY_BUFFER, _inst_id_buf);
+        glEnableVertexAttribArray(_inst_loc);
+        glVertexAttribIPointer(_inst_loc, 1, GL_INT, sizeof(int), (void *) nullptr);
+        glVertexAttribDivisor(_inst_loc, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(0);
+    }
+
+    void reserveObjects(unsigned n) {
+        if (n <= _inst_capacity) return;
+
+        unsigned capacity = std::max(_inst_capacity * 2, n);
+
+        std::vector<int> ids(capacity);
+        for (unsigned i = 0; i < capacity; ++i) ids[i] = (int) i;
+
+        if (!_inst_id_buf) glGenBuffers(1, &_inst_id_buf);
+        glBindBuffer(GL_ARRAY_BUFFER, _inst_id_buf);
+        util::bufferData(GL_ARRAY_BUFFER, ids, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        _inst_capacity = capacity;
+        bindArray();
+    }
+
+public:
+    using MeshId = unsigned;
+    using ObjectId = unsigned;
+
+    /// `ind_loc` and `inst_loc` are the `vInds` and `vInst` attribute locations
+    void init(GLuint ind_loc, GLuint inst_loc, unsigned verts = 1u << 16, unsigned cells = 1u << 16) {
+        _ind_loc = ind_loc;
+        _inst_loc = inst_loc;
+
+        _vert_alloc = RangeAllocator(verts);
+        _cell_alloc = RangeAllocator(cells);
+
+        resize(_vert_buf, 0, verts * sizeof(glm::vec4), GL_STATIC_DRAW);
+        resize(_cell_buf, 0, cells * 4 * sizeof(unsigned), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &_inst_buf);
+        glGenBuffers(1, &_cmd_buf);
+        glGenVertexArrays(1, &_array);
+
+        reserveObjects(64);
+    }
+
+    MeshId addMesh(const Mesh<4> &mesh) {
+        MeshRange range{};
+        range.vert_count = (unsigned) mesh.verts.size();
+        range.cell_count = mesh.size();
+
+        auto old_cells = _cell_buf;
+        range.first_vert = allocate(_vert_alloc, range.vert_count, _vert_buf, sizeof(glm::vec4));
+        range.first_cell = allocate(_cell_alloc, range.cell_count, _cell_buf, 4 * sizeof(unsigned));
+        if (_cell_buf != old_cells) bindArray();
+
+        std::vector<unsigned> inds(mesh.inds.begin(), mesh.inds.end());
+        for (auto &i : inds) i += range.first_vert;
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _vert_buf);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.first_vert * sizeof(glm::vec4),
+            mesh.verts.size() * sizeof(glm::vec4), mesh.verts.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _cell_buf);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.first_cell * 4 * sizeof(unsigned),
+            inds.size() * sizeof(unsigned), inds.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        if (!_free_meshes.empty()) {
+            MeshId id = _free_meshes.back();
+            _free_meshes.pop_back();
+            _meshes[id] = range;
+            return id;
+        }
+
+        _meshes.push_back(range);
+        return (MeshId) _meshes.size() - 1;
+    }
+
+    /// the mesh must no longer be referenced by any object
+    void removeMesh(MeshId id) {
+        auto &range = _meshes[id];
+        _vert_alloc.release(range.first_vert, range.vert_count);
+        _cell_alloc.release(range.first_cell, range.cell_count);
+        range = {};
+        _free_meshes.push_back(id);
+    }
+
+    ObjectId addObject(MeshId mesh, const Instance &instance) {
+        ObjectId id;
+        if (!_free_objects.empty()) {
+            id = _free_objects.back();
+            _free_objects.pop_back();
+        } else {
+            id = (ObjectId) _object_slot.size();
+            _object_slot.push_back(npos);
+        }
+
+        auto slot = (unsigned) _instances.size();
+        reserveObjects(slot + 1);
+
+        const auto &range = _meshes[mesh];
+        _instances.push_back(instance);
+        _commands.push_back({range.cell_count, 1, range.first_cell, slot});
+        _hidden.push_back(false);
+        _slot_object.push_back(id);
+        _object_slot[id] = slot;
+
+        _dirty = true;
+        return id;
+    }
+
+    /// moves the last slot into the hole so the command list stays dense
+    void removeObject(ObjectId id) {
+        unsigned slot = _object_slot[id];
+        auto last = (unsigned) _instances.size() - 1;
+
+        if (slot != last) {
+            _instances[slot] = _instances[last];
+            _commands[slot] = _commands[last];
+            _commands[slot].base_instance = slot;
+            _hidden[slot] = _hidden[last];
+            _slot_object[slot] = _slot_object[last];
+            _object_slot[_slot_object[slot]] = slot;
+        }
+
+        _instances.pop_back();
+        _commands.pop_back();
+        _hidden.pop_back();
+        _slot_object.pop_back();
+
+        _object_slot[id] = npos;
+        _free_objects.push_back(id);
+        _dirty = true;
+    }
+
+    /// points an object at another mesh, such as a coarser level of detail
+    void setMesh(ObjectId id, MeshId mesh) {
+        auto &command = _commands[_object_slot[id]];
+        const auto &range = _meshes[mesh];
+        if (command.first == range.first_cell && command.count == range.cell_count) return;
+
+        command.count = range.cell_count;
+        command.first = range.first_cell;
+        _dirty = true;
+    }
+
+    /// leaves an object out of draw(true), while draw() still draws it
+    void setHidden(ObjectId id, bool hidden) {
+        auto &flag = _hidden[_object_slot[id]];
+        if (flag == hidden) return;
+
+        flag = hidden;
+        _dirty = true;
+    }
+
+    /// writable transform of an object; the table is re-uploaded on the next upload()
+    Instance &transform(ObjectId id) {
+        _dirty = true;
+        return _instances[_object_slot[id]];
+    }
+
+    unsigned objectCount() const { return (unsigned) _instances.size(); }
+
+    void upload() {
+        if (!_dirty) return;
+
+        auto n = (unsigned) _instances.size();
+        if (n > _cmd_capacity) {
+            _cmd_capacity = _inst_capacity;
+
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, _inst_buf);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, _cmd_capacity * sizeof(Instance), nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _cmd_buf);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, 2 * _cmd_capacity * sizeof(util::DrawArraysIndirectCommand), nullptr,
+                GL_DYNAMIC_DRAW);
+        }
+
+        _visible = _commands;
+        for (unsigned i = 0; i < n; ++i)
+            if (_hidden[i]) _visible[i].count = 0;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _inst_buf);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, n * sizeof(Instance), _instances.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _cmd_buf);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, n * sizeof(util::DrawArraysIndirectCommand), _commands.data());
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, _cmd_capacity * sizeof(util::DrawArraysIndirectCommand),
+            n * sizeof(util::DrawArraysIndirectCommand), _visible.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        _dirty = false;
+    }
+
+    /// binds the shared vertices and the instance table to the shaders' SSBO binding points
+    void bind(GLuint verts_binding, GLuint instances_binding) const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, verts_binding, _vert_buf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instances_binding, _inst_buf);
+    }
+
+    /// one call for every object, or only the objects not hidden, with whatever program is current
+    void draw(bool visible_only = false) const {
+        if (_instances.empty()) return;
+
+        auto offset = visible_only ? _cmd_capacity * sizeof(util::DrawArraysIndirectCommand) : 0;
+
+        glBindVertexArray(_array);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _cmd_buf);
+        glMultiDrawArraysIndirect(GL_POINTS, (const void *) offset, (GLsizei) _instances.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    void release() {
+        GLuint bufs[] = {_vert_buf, _cell_buf, _inst_buf, _inst_id_buf, _cmd_buf};
+        glDeleteBuffers(5, bufs);
+        glDeleteVertexArrays(1, &_array);
+
+        _vert_buf = _cell_buf = _inst_buf = _inst_id_buf = _cmd_buf = 0;
+        _array = 0;
+    }
+};
+
+#endif //SIMPLEX_SCENE_H
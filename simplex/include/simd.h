@@ -0,0 +1,108 @@
+#ifndef SIMPLEX_SIMD_H
+#define SIMPLEX_SIMD_H
+
+#include <cstddef>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Minimal packed-float abstraction. Picks the widest instruction set the
+ * compiler targets (AVX, SSE2, or plain scalar), so kernels are written once
+ * against `simd::f32` and `simd::width`.
+ */
+namespace simd {
+#if defined(__AVX__)
+    constexpr int width = 8;
+
+    struct f32 {
+        __m256 v;
+    };
+
+    inline f32 load(const float *p) { return {_mm256_loadu_ps(p)}; }
+
+    inline void store(float *p, f32 a) { _mm256_storeu_ps(p, a.v); }
+
+    inline f32 broadcast(float s) { return {_mm256_set1_ps(s)}; }
+
+    inline f32 operator+(f32 a, f32 b) { return {_mm256_add_ps(a.v, b.v)}; }
+
+    inline f32 operator-(f32 a, f32 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+
+    inline f32 operator*(f32 a, f32 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+
+    inline f32 operator/(f32 a, f32 b) { return {_mm256_div_ps(a.v, b.v)}; }
+
+    inline f32 min(f32 a, f32 b) { return {_mm256_min_ps(a.v, b.v)}; }
+
+    inline f32 max(f32 a, f32 b) { return {_mm256_max_ps(a.v, b.v)}; }
+
+    /// one bit per lane, set where a < b
+    inline int lessMask(f32 a, f32 b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+    constexpr int width = 4;
+
+    struct f32 {
+        __m128 v;
+    };
+
+    inline f32 load(const float *p) { return {_mm_loadu_ps(p)}; }
+
+    inline void store(float *p, f32 a) { _mm_storeu_ps(p, a.v); }
+
+    inline f32 broadcast(float s) { return {_mm_set1_ps(s)}; }
+
+    inline f32 operator+(f32 a, f32 b) { return {_mm_add_ps(a.v, b.v)}; }
+
+    inline f32 operator-(f32 a, f32 b) { return {_mm_sub_ps(a.v, b.v)}; }
+
+    inline f32 operator*(f32 a, f32 b) { return {_mm_mul_ps(a.v, b.v)}; }
+
+    inline f32 operator/(f32 a, f32 b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    inline f32 min(f32 a, f32 b) { return {_mm_min_ps(a.v, b.v)}; }
+
+    inline f32 max(f32 a, f32 b) { return {_mm_max_ps(a.v, b.v)}; }
+
+    /// one bit per lane, set where a < b
+    inline int lessMask(f32 a, f32 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+
+#else
+    constexpr int width = 1;
+
+    struct f32 {
+        float v;
+    };
+
+    inline f32 load(const float *p) { return {*p}; }
+
+    inline void store(float *p, f32 a) { *p = a.v; }
+
+    inline f32 broadcast(float s) { return {s}; }
+
+    inline f32 operator+(f32 a, f32 b) { return {a.v + b.v}; }
+
+    inline f32 operator-(f32 a, f32 b) { return {a.v - b.v}; }
+
+    inline f32 operator*(f32 a, f32 b) { return {a.v * b.v}; }
+
+    inline f32 operator/(f32 a, f32 b) { return {a.v / b.v}; }
+
+    inline f32 min(f32 a, f32 b) { return {a.v < b.v ? a.v : b.v}; }
+
+    inline f32 max(f32 a, f32 b) { return {a.v < b.v ? b.v : a.v}; }
+
+    /// one bit per lane, set where a < b
+    inline int lessMask(f32 a, f32 b) { return a.v < b.v; }
+
+#endif
+
+    /// number of floats needed to hold n values padded to whole vectors
+    inline size_t padded(size_t n) { return (n + width - 1) / width * width; }
+}
+
+#endif //SIMPLEX_SIMD_H
@@ -0,0 +1,263 @@
+#ifndef SIMPLEX_SLICE_H
+#define SIMPLEX_SLICE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "mesh.h"
+#include "simd.h"
+
+/*
+ * The unique edges of a tetrahedral mesh, lower index first, and for every
+ * tetrahedron the indices of its six edges in the order of edgeSlot(). A
+ * section built over it intersects each edge once and shares the point
+ * between all the tetrahedra around the edge. It only depends on the
+ * indices, so it is built once per mesh.
+ */
+struct EdgeTable {
+    std::vector<unsigned> lo, hi;
+    std::vector<unsigned> tet_edges;
+
+    /// slot of the edge between local vertices i and j of a tetrahedron, in either order
+    static unsigned edgeSlot(unsigned i, unsigned j) {
+        static const uint8_t slots[4][4] = {
+            {0, 0, 1, 2},
+            {0, 0, 3, 4},
+            {1, 3, 0, 5},
+            {2, 4, 5, 0},
+        };
+        return slots[i][j];
+    }
+
+    void build(const Mesh<4> &mesh) {
+        std::unordered_map<uint64_t, unsigned> ids;
+        ids.reserve(mesh.inds.size());
+
+        lo.clear();
+        hi.clear();
+        tet_edges.resize(mesh.size() * 6);
+
+        for (unsigned t = 0; t < mesh.size(); ++t) {
+            const unsigned *ind = &mesh.inds[t * 4];
+
+            for (unsigned i = 0; i < 4; ++i) {
+                for (unsigned j = i + 1; j < 4; ++j) {
+                    unsigned a = std::min(ind[i], ind[j]);
+                    unsigned b = std::max(ind[i], ind[j]);
+
+                    auto it = ids.emplace((uint64_t) a << 32 | b, (unsigned) lo.size());
+                    if (it.second) {
+                        lo.push_back(a);
+                        hi.push_back(b);
+                    }
+                    tet_edges[t * 6 + edgeSlot(i, j)] = it.first->second;
+                }
+            }
+        }
+    }
+
+    size_t size() const { return lo.size(); }
+};
+
+/*
+ * CPU counterpart of shaders/sect.geom. Vertices are transformed by
+ * `offset + model * v` in structure-of-arrays form and classified against
+ * w = 0 with packed SIMD; each tetrahedron then looks up its sign pattern
+ * and emits the same triangles the geometry shader would, three vertices per
+ * triangle, in the same order and winding.
+ */
+class Slicer {
+public:
+    /// transformed vertex components, padded to a whole number of simd vectors
+    std::vector<float> x, y, z, w;
+
+    /// 1 where the transformed vertex lies below the hyperplane (w < 0)
+    std::vector<uint8_t> below;
+
+    /// per edge of an EdgeTable, its section vertex; only valid for crossing edges
+    std::vector<unsigned> edge_verts;
+
+    void transform(const Mesh<4> &mesh, const glm::mat4 &model, glm::vec4 offset) {
+        auto n = mesh.verts.size();
+        auto padded = simd::padded(n);
+
+        x.resize(padded);
+        y.resize(padded);
+        z.resize(padded);
+        w.resize(padded);
+        below.resize(padded);
+
+        for (size_t i = 0; i < n; ++i) {
+            const auto &v = mesh.verts[i];
+            x[i] = v.x;
+            y[i] = v.y;
+            z[i] = v.z;
+            w[i] = v.w;
+        }
+        for (size_t i = n; i < padded; ++i) x[i] = y[i] = z[i] = w[i] = 0;
+
+        simd::f32 m[4][4], o[4];
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) m[c][r] = simd::broadcast(model[c][r]);
+            o[c] = simd::broadcast(offset[c]);
+        }
+        auto zero = simd::broadcast(0);
+
+        for (size_t i = 0; i < padded; i += simd::width) {
+            simd::f32 in[4] = {
+                simd::load(&x[i]), simd::load(&y[i]),
+                simd::load(&z[i]), simd::load(&w[i]),
+            };
+
+            simd::f32 out[4];
+            for (int r = 0; r < 4; ++r)
+                out[r] = o[r] + m[0][r] * in[0] + m[1][r] * in[1] + m[2][r] * in[2] + m[3][r] * in[3];
+
+            simd::store(&x[i], out[0]);
+            simd::store(&y[i], out[1]);
+            simd::store(&z[i], out[2]);
+            simd::store(&w[i], out[3]);
+
+            int mask = simd::lessMask(out[3], zero);
+            for (int l = 0; l < simd::width; ++l) below[i + l] = (uint8_t) ((mask >> l) & 1);
+        }
+    }
+
+    /// appends the section triangles of the last transformed mesh to `out`
+    size_t emit(const Mesh<4> &mesh, std::vector<glm::vec4> &out) const {
+        const auto &table = edgeTable();
+        auto start = out.size();
+
+        for (unsigned t = 0; t < mesh.size(); ++t) {
+            const unsigned *ind = &mesh.inds[t * 4];
+
+            unsigned code = 0;
+            for (unsigned i = 0; i < 4; ++i) code |= below[ind[i]] << i;
+
+            const auto &edges = table[code];
+            if (edges.count < 3) continue;
+
+            glm::vec4 sect[4];
+            for (int s = 0; s < edges.count; ++s)
+                sect[s] = intersect(ind[edges.lo[s]], ind[edges.hi[s]]);
+
+            out.push_back(sect[0]);
+            out.push_back(sect[1]);
+            out.push_back(sect[2]);
+
+            // second triangle of the strip, with the strip's alternating winding
+            if (edges.count == 4) {
+                out.push_back(sect[2]);
+                out.push_back(sect[1]);
+                out.push_back(sect[3]);
+            }
+        }
+
+        return (out.size() - start) / 3;
+    }
+
+    size_t slice(const Mesh<4> &mesh, const glm::mat4 &model, glm::vec4 offset, std::vector<glm::vec4> &out) {
+        transform(mesh, model, offset);
+        return emit(mesh, out);
+    }
+
+    /*
+     * Indexed, watertight section of the last transformed mesh, appended to
+     * `out`. Each crossing edge of `edges` is intersected once, and every
+     * tetrahedron around it refers to that one vertex, so neighbouring
+     * triangles share vertices exactly. Triangles come out in the same order
+     * and winding as emit().
+     */
+    size_t emitIndexed(const Mesh<4> &mesh, const EdgeTable &edges, Mesh<3> &out) {
+        const auto &table = edgeTable();
+        auto start = out.inds.size();
+
+        edge_verts.resize(edges.size());
+        for (size_t e = 0; e < edges.size(); ++e) {
+            unsigned a = edges.lo[e], b = edges.hi[e];
+            if (below[a] == below[b]) continue;
+
+            // always from the vertex below, as sect.geom computes it
+            edge_verts[e] = (unsigned) out.verts.size();
+            out.verts.push_back(below[a] ? intersect(a, b) : intersect(b, a));
+        }
+
+        for (unsigned t = 0; t < mesh.size(); ++t) {
+            const unsigned *ind = &mesh.inds[t * 4];
+
+            unsigned code = 0;
+            for (unsigned i = 0; i < 4; ++i) code |= below[ind[i]] << i;
+
+            const auto &sect = table[code];
+            if (sect.count < 3) continue;
+
+            unsigned v[4];
+            for (int s = 0; s < sect.count; ++s)
+                v[s] = edge_verts[edges.tet_edges[t * 6 + EdgeTable::edgeSlot(sect.lo[s], sect.hi[s])]];
+
+            out.inds.insert(out.inds.end(), {v[0], v[1], v[2]});
+            if (sect.count == 4) out.inds.insert(out.inds.end(), {v[2], v[1], v[3]});
+        }
+
+        return (out.inds.size() - start) / 3;
+    }
+
+    size_t sliceIndexed(const Mesh<4> &mesh, const EdgeTable &edges,
+        const glm::mat4 &model, glm::vec4 offset, Mesh<3> &out) {
+        transform(mesh, model, offset);
+        return emitIndexed(mesh, edges, out);
+    }
+
+    glm::vec4 vert(unsigned i) const {
+        return {x[i], y[i], z[i], w[i]};
+    }
+
+    glm::vec4 intersect(unsigned l, unsigned h) const {
+        glm::vec4 a = vert(l);
+        glm::vec4 b = vert(h);
+        return (0 - a.w) / (b.w - a.w) * (b - a) + a;
+    }
+
+    struct Edges {
+        int count;
+        std::array<uint8_t, 4> lo, hi;
+    };
+
+    /// section edges for each of the 16 below/above patterns, in sect.geom's order
+    static const std::array<Edges, 16> &edgeTable() {
+        static const std::array<Edges, 16> table = [] {
+            std::array<Edges, 16> res{};
+
+            for (unsigned code = 0; code < 16; ++code) {
+                uint8_t lo[4], hi[4];
+                int L = 0, H = 0;
+
+                for (uint8_t i = 0; i < 4; ++i) {
+                    if (code & (1u << i)) lo[L++] = i;
+                    else hi[H++] = i;
+                }
+
+                auto &e = res[code];
+                for (int l = 0; l < L; ++l) {
+                    for (int h = 0; h < H; ++h) {
+                        e.lo[e.count] = lo[l];
+                        e.hi[e.count] = hi[h];
+                        e.count++;
+                    }
+                }
+            }
+
+            return res;
+        }();
+
+        return table;
+    }
+};
+
+#endif //SIMPLEX_SLICE_H
@@ -0,0 +1,176 @@
+#ifndef SIMPLEX_SLICEN_H
+#define SIMPLEX_SLICEN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "meshn.h"
+#include "simd.h"
+
+/*
+ * Cuts a closed boundary of (dim - 1)-simplices with the hyperplane
+ * x[dim - 1] = h, and drops that axis. The result is a closed boundary one
+ * dimension lower, so the cut can be repeated until triangles remain.
+ *
+ * A simplex with L vertices below the plane and H above meets it in the
+ * product of an (L - 1)- and an (H - 1)-simplex. Its corners are the crossing
+ * edges (lo_a, hi_b). The staircase triangulation splits it into one simplex
+ * per monotone path from (0, 0) to (L - 1, H - 1). With lo and hi sorted by
+ * global vertex index, neighbours agree on their shared faces. Crossing
+ * edges are deduplicated, so the output stays indexed.
+ *
+ * The sign tests run packed across simd::width primitives at a time. The
+ * edge intersections run packed across edges in structure-of-arrays form.
+ */
+class SlicerN {
+    /// per primitive, bit j set where vertex j lies below the plane
+    std::vector<uint8_t> codes;
+
+    /// crossing edges by (below << 32 | above), and their endpoints in order of discovery
+    std::unordered_map<uint64_t, unsigned> edge_ids;
+    std::vector<unsigned> edge_lo, edge_hi;
+
+    /// scratch for the packed passes
+    std::vector<float> lane, wa, wb, t, ca, cb, out;
+
+    unsigned edge(unsigned lo, unsigned hi) {
+        auto key = (uint64_t) lo << 32 | hi;
+        auto it = edge_ids.emplace(key, (unsigned) edge_lo.size());
+        if (it.second) {
+            edge_lo.push_back(lo);
+            edge_hi.push_back(hi);
+        }
+        return it.first->second;
+    }
+
+    template<std::size_t dim, unsigned prim>
+    void classify(const MeshN<dim, prim> &m, float h) {
+        auto n = m.size();
+        auto padded = simd::padded(n);
+
+        codes.assign(padded, 0);
+        lane.resize(simd::width);
+
+        auto plane = simd::broadcast(h);
+
+        for (size_t p = 0; p < padded; p += simd::width) {
+            for (unsigned j = 0; j < prim; ++j) {
+                for (int l = 0; l < simd::width; ++l) {
+                    auto q = p + l;
+                    lane[l] = q < n ? m.verts[m.inds[q * prim + j]][dim - 1] : h;
+                }
+
+                int mask = simd::lessMask(simd::load(lane.data()), plane);
+                for (int l = 0; l < simd::width; ++l)
+                    codes[p + l] |= (uint8_t) (((mask >> l) & 1) << j);
+            }
+        }
+    }
+
+    template<std::size_t dim, unsigned prim>
+    void intersect(const MeshN<dim, prim> &m, float h, std::vector<VecN<dim - 1>> &verts) {
+        auto n = edge_lo.size();
+        auto padded = simd::padded(n);
+
+        wa.resize(padded);
+        wb.resize(padded);
+        t.resize(padded);
+        ca.resize(padded);
+        cb.resize(padded);
+        out.resize(padded);
+
+        for (size_t e = 0; e < padded; ++e) {
+            // padding lanes get a harmless crossing at t = 1/2
+            wa[e] = e < n ? m.verts[edge_lo[e]][dim - 1] - h : -1;
+            wb[e] = e < n ? m.verts[edge_hi[e]][dim - 1] - h : 1;
+        }
+
+        for (size_t e = 0; e < padded; e += simd::width) {
+            auto a = simd::load(&wa[e]);
+            auto b = simd::load(&wb[e]);
+            simd::store(&t[e], a / (a - b));
+        }
+
+        verts.resize(n);
+        for (unsigned k = 0; k < dim - 1; ++k) {
+            for (size_t e = 0; e < padded; ++e) {
+                ca[e] = e < n ? m.verts[edge_lo[e]][k] : 0;
+                cb[e] = e < n ? m.verts[edge_hi[e]][k] : 0;
+            }
+
+            for (size_t e = 0; e < padded; e += simd::width) {
+                auto a = simd::load(&ca[e]);
+                auto b = simd::load(&cb[e]);
+                simd::store(&out[e], a + simd::load(&t[e]) * (b - a));
+            }
+
+            for (size_t e = 0; e < n; ++e) verts[e][k] = out[e];
+        }
+    }
+
+public:
+    template<std::size_t dim, unsigned prim>
+    MeshN<dim - 1, prim - 1> slice(const MeshN<dim, prim> &m, float h = 0) {
+        static_assert(dim >= 2 && prim >= 2 && prim <= 8, "SlicerN needs 2 <= prim <= 8");
+
+        classify(m, h);
+
+        edge_ids.clear();
+        edge_lo.clear();
+        edge_hi.clear();
+
+        MeshN<dim - 1, prim - 1> res;
+
+        constexpr unsigned full = (1u << prim) - 1;
+        for (unsigned p = 0; p < m.size(); ++p) {
+            unsigned code = codes[p];
+            if (code == 0 || code == full) continue;
+
+            const unsigned *ind = &m.inds[p * prim];
+
+            unsigned lo[prim], hi[prim];
+            unsigned L = 0, H = 0;
+            for (unsigned j = 0; j < prim; ++j) {
+                if (code & (1u << j)) lo[L++] = ind[j];
+                else hi[H++] = ind[j];
+            }
+            std::sort(lo, lo + L);
+            std::sort(hi, hi + H);
+
+            // bit s of `path` set: step s advances along lo, otherwise along hi
+            unsigned steps = L + H - 2;
+            for (unsigned path = 0; path < (1u << steps); ++path) {
+                if ((unsigned) __builtin_popcount(path) != L - 1) continue;
+
+                unsigned a = 0, b = 0;
+                res.inds.push_back(edge(lo[a], hi[b]));
+                for (unsigned s = 0; s < steps; ++s) {
+                    if (path & (1u << s)) ++a;
+                    else ++b;
+                    res.inds.push_back(edge(lo[a], hi[b]));
+                }
+            }
+        }
+
+        intersect(m, h, res.verts);
+        return res;
+    }
+
+    /// slices at x[dim - 1] = h[0], then x[dim - 2] = h[1], and so on down to triangles
+    template<std::size_t dim, unsigned prim>
+    MeshN<3, 3> sliceTo3(const MeshN<dim, prim> &m, const float *h) {
+        static_assert(dim == prim && dim >= 3, "sliceTo3 needs a closed boundary of (dim - 1)-simplices");
+
+        if constexpr (dim == 3) {
+            return m;
+        } else {
+            return sliceTo3(slice(m, h[0]), h + 1);
+        }
+    }
+};
+
+#endif //SIMPLEX_SLICEN_H
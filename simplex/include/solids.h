@@ -1,15 +1,21 @@
 #ifndef SIMPLEX_SOLIDS_H
 #define SIMPLEX_SOLIDS_H
 
+#include <glm/gtc/constants.hpp>
+
 #include "mesh.h"
 #include "rotor.h"
+#include "static_mesh.h"
+
+// meshes built here are cached on disk: bump MESH_GENERATOR_VERSION
+// (mesh_cache.h) with any change to the geometry they produce
 
-static auto T = (float) PI / 2;
+static auto T = glm::pi<float>() / 2;
 
 Mesh<2> poly(int sides) {
     Mesh<2> res({}, {});
 
-    auto t = (float) (PI * 2 / sides);
+    auto t = (float) (glm::pi<double>() * 2 / sides);
     float t0 = t / 2;
     auto r = 1 / cos(t0);
 
@@ -26,39 +32,47 @@ Mesh<2> poly(int sides) {
     return res;
 }
 
-Mesh<3> cube() {
-    glm::vec4 off = glm::vec4(0, 0, 1, 0);
-    Mesh<3> face = fill(poly(4));
-    Mesh<3> pair = (face + off) + (face - off);
+namespace cx {
+    constexpr auto cube() {
+        auto face = fill(square());
+        auto pair = concat(offset(face, {0, 0, 1, 0}), offset(face, {0, 0, -1, 0}));
+
+        return concat(concat(pair, quarter<0, 2>(pair)), quarter<1, 2>(pair));
+    }
+
+    constexpr auto tesseract() {
+        auto cell = fill(cube());
+        auto pair = concat(offset(cell, {0, 0, 0, 1}), offset(cell, {0, 0, 0, -1}));
 
-    return pair +
-        rot_xz(T) * pair +
-        rot_yz(T) * pair;
+        return concat(concat(concat(pair, quarter<0, 3>(pair)), quarter<1, 3>(pair)), quarter<2, 3>(pair));
+    }
 }
 
-Mesh<4> tesseract() {
-    glm::vec4 off = glm::vec4(0, 0, 0, 1);
-    Mesh<4> cell = fill(cube());
-    Mesh<4> pair = (cell + off) + (cell - off);
+/// generated at compile time; cube() and tesseract() only copy them out
+constexpr auto static_cube = cx::cube();
+constexpr auto static_tesseract = cx::tesseract();
+
+Mesh<3> cube() {
+    return static_cube.mesh();
+}
 
-    return pair +
-        rot_xw(T) * pair +
-        rot_yw(T) * pair +
-        rot_zw(T) * pair;
+Mesh<4> tesseract() {
+    return static_tesseract.mesh();
 }
 
 Mesh<4> tesseract_edge_frame(float width) {
     Mesh<4> edge = tesseract() * glm::vec4(width, width, width, 1);
     auto o = glm::vec3(1 - width);
 
-    Mesh<4> set = (edge + glm::vec4(+o.x, +o.y, +o.z, 0)) +
-        (edge + glm::vec4(+o.x, +o.y, -o.z, 0)) +
-        (edge + glm::vec4(+o.x, -o.y, +o.z, 0)) +
-        (edge + glm::vec4(+o.x, -o.y, -o.z, 0)) +
-        (edge + glm::vec4(-o.x, +o.y, +o.z, 0)) +
-        (edge + glm::vec4(-o.x, +o.y, -o.z, 0)) +
-        (edge + glm::vec4(-o.x, -o.y, +o.z, 0)) +
-        (edge + glm::vec4(-o.x, -o.y, -o.z, 0));
+    // `set` stays lazy, so the whole frame is written in a single pass
+    auto set = (lazy(edge) + glm::vec4(+o.x, +o.y, +o.z, 0)) +
+        (lazy(edge) + glm::vec4(+o.x, +o.y, -o.z, 0)) +
+        (lazy(edge) + glm::vec4(+o.x, -o.y, +o.z, 0)) +
+        (lazy(edge) + glm::vec4(+o.x, -o.y, -o.z, 0)) +
+        (lazy(edge) + glm::vec4(-o.x, +o.y, +o.z, 0)) +
+        (lazy(edge) + glm::vec4(-o.x, +o.y, -o.z, 0)) +
+        (lazy(edge) + glm::vec4(-o.x, -o.y, +o.z, 0)) +
+        (lazy(edge) + glm::vec4(-o.x, -o.y, -o.z, 0));
 
     return set +
         rot_xw(T) * set +
@@ -66,6 +80,25 @@ Mesh<4> tesseract_edge_frame(float width) {
         rot_zw(T) * set;
 }
 
+/// the transforms that place the copies of the edge in tesseract_edge_frame
+std::vector<Instance> tesseract_edge_frame_instances(float width) {
+    auto o = glm::vec3(1 - width);
+
+    std::vector<Instance> res;
+    for (auto rot : {glm::mat4(1), rot_xw(T), rot_yw(T), rot_zw(T)})
+        for (float x : {+o.x, -o.x})
+            for (float y : {+o.y, -o.y})
+                for (float z : {+o.z, -o.z})
+                    res.push_back({rot, rot * glm::vec4(x, y, z, 0)});
+
+    return res;
+}
+
+InstancedMesh<4> tesseract_edge_frame_instanced(float width) {
+    Mesh<4> edge = tesseract() * glm::vec4(width, width, width, 1);
+    return {edge, tesseract_edge_frame_instances(width)};
+}
+
 Mesh<4> tesseract_face_frame(float width) {
     //todo - not even sure what this would mean, but it should be possible.
     return Mesh<4>({}, {});
@@ -74,13 +107,32 @@ Mesh<4> tesseract_face_frame(float width) {
 Mesh<4> tesseract_cell_frame(float width) {
     glm::vec4 off = glm::vec4(0, 0, 0, 1);
     Mesh<4> cell = join(cube() * (1 - width), cube());
-    cell = cell + (cell - glm::vec4(0, 0, 0, width));
-    Mesh<4> pair = (cell + off) + (cell + off) * -1.f;
+    cell = lazy(cell) + (lazy(cell) - glm::vec4(0, 0, 0, width));
+    Mesh<4> pair = (lazy(cell) + off) + (lazy(cell) + off) * -1.f;
+
+    return lazy(pair) +
+        rot_xw(T) * lazy(pair) +
+        rot_yw(T) * lazy(pair) +
+        rot_zw(T) * lazy(pair);
+}
 
-    return pair +
-        rot_xw(T) * pair +
-        rot_yw(T) * pair +
-        rot_zw(T) * pair;
+/// the transforms that place the copies of the cell in tesseract_cell_frame
+std::vector<Instance> tesseract_cell_frame_instances() {
+    glm::vec4 off = glm::vec4(0, 0, 0, 1);
+
+    std::vector<Instance> res;
+    for (auto rot : {glm::mat4(1), rot_xw(T), rot_yw(T), rot_zw(T)}) {
+        res.push_back({rot, rot * off});
+        res.push_back({-rot, rot * -off});
+    }
+
+    return res;
+}
+
+InstancedMesh<4> tesseract_cell_frame_instanced(float width) {
+    Mesh<4> cell = join(cube() * (1 - width), cube());
+    cell = lazy(cell) + (lazy(cell) - glm::vec4(0, 0, 0, width));
+    return {cell, tesseract_cell_frame_instances()};
 }
 
 #endif //SIMPLEX_SOLIDS_H
@@ -0,0 +1,94 @@
+#ifndef SIMPLEX_STATIC_MESH_H
+#define SIMPLEX_STATIC_MESH_H
+
+#include <array>
+#include <cstddef>
+
+#include <glm/vec4.hpp>
+
+#include "mesh.h"
+
+/*
+ * Fixed-size mesh whose combinators are all constexpr, so solids with a
+ * known shape can be generated entirely at compile time into static arrays.
+ * Rotations are limited to exact quarter turns of the coordinate planes,
+ * which is all the fixed solids need and keeps every coordinate exact.
+ */
+template<unsigned prim, std::size_t V, std::size_t I>
+struct StaticMesh {
+    std::array<std::array<float, 4>, V> verts{};
+    std::array<unsigned, I> inds{};
+
+    static constexpr unsigned size() { return (unsigned) (I / prim); }
+
+    Mesh<prim> mesh() const {
+        Mesh<prim> res({}, {});
+        res.inds.assign(inds.begin(), inds.end());
+        res.verts.reserve(V);
+        for (const auto &v : verts) res.verts.emplace_back(v[0], v[1], v[2], v[3]);
+        return res;
+    }
+};
+
+namespace cx {
+    /// the square from poly(4), with its three edges
+    constexpr StaticMesh<2, 4, 6> square() {
+        return {
+            {{{1, 1, 0, 0}, {-1, 1, 0, 0}, {-1, -1, 0, 0}, {1, -1, 0, 0}}},
+            {0, 1, 1, 2, 2, 3}
+        };
+    }
+
+    template<unsigned prim, std::size_t V1, std::size_t I1, std::size_t V2, std::size_t I2>
+    constexpr StaticMesh<prim, V1 + V2, I1 + I2> concat(
+        const StaticMesh<prim, V1, I1> &m, const StaticMesh<prim, V2, I2> &n
+    ) {
+        StaticMesh<prim, V1 + V2, I1 + I2> res{};
+        for (std::size_t i = 0; i < V1; ++i) res.verts[i] = m.verts[i];
+        for (std::size_t i = 0; i < V2; ++i) res.verts[V1 + i] = n.verts[i];
+        for (std::size_t i = 0; i < I1; ++i) res.inds[i] = m.inds[i];
+        for (std::size_t i = 0; i < I2; ++i) res.inds[I1 + i] = (unsigned) V1 + n.inds[i];
+        return res;
+    }
+
+    template<unsigned prim, std::size_t V, std::size_t I>
+    constexpr StaticMesh<prim, V, I> offset(StaticMesh<prim, V, I> m, std::array<float, 4> off) {
+        for (auto &v : m.verts)
+            for (std::size_t k = 0; k < 4; ++k) v[k] += off[k];
+        return m;
+    }
+
+    template<unsigned prim, std::size_t V, std::size_t I>
+    constexpr StaticMesh<prim, V, I> scale(StaticMesh<prim, V, I> m, std::array<float, 4> scl) {
+        for (auto &v : m.verts)
+            for (std::size_t k = 0; k < 4; ++k) v[k] *= scl[k];
+        return m;
+    }
+
+    /// exact rot<i, j>(pi / 2): e_i -> e_j, e_j -> -e_i
+    template<int i, int j, unsigned prim, std::size_t V, std::size_t I>
+    constexpr StaticMesh<prim, V, I> quarter(StaticMesh<prim, V, I> m) {
+        for (auto &v : m.verts) {
+            float vi = v[i], vj = v[j];
+            v[i] = -vj;
+            v[j] = vi;
+        }
+        return m;
+    }
+
+    /// same indexing as fill(): a cone from each primitive to vertex 0
+    template<unsigned prim, std::size_t V, std::size_t I>
+    constexpr StaticMesh<prim + 1, V, I / prim * (prim + 1)> fill(const StaticMesh<prim, V, I> &m) {
+        StaticMesh<prim + 1, V, I / prim * (prim + 1)> res{};
+        res.verts = m.verts;
+
+        std::size_t k = 0;
+        for (std::size_t p = 0; p < I / prim; ++p) {
+            for (std::size_t j = 0; j < prim; ++j) res.inds[k++] = m.inds[p * prim + j];
+            res.inds[k++] = 0;
+        }
+        return res;
+    }
+}
+
+#endif //SIMPLEX_STATIC_MESH_H
@@ -0,0 +1,31 @@
+#version 440 core
+
+layout(std430, binding=1) buffer Positions {
+    vec4 verts[];
+};
+
+struct Instance {
+    mat4 model;
+    vec4 offset;
+};
+
+layout(std430, binding=5) buffer Instances {
+    Instance instances[];
+};
+
+layout(std140, binding=1) uniform Matrices {
+    mat4 model;
+    vec4 offset;
+
+    mat4 view;
+    mat4 proj;
+};
+
+out vec4 pos;
+
+void main() {
+    Instance instance = instances[gl_InstanceID];
+
+    pos = offset + model * (instance.model * verts[gl_VertexID] + instance.offset);
+    gl_Position = proj * view * vec4(pos.xyz, 1 - pos.w / 2);
+}
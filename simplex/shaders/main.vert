@@ -1,11 +1,14 @@
 #version 440 core
 
 layout(location=0) in ivec4 vInds;
+layout(location=1) in int vInst;
 
 out ivec4 inds;
+out int inst;
 
 void main() {
     inds = vInds;
+    inst = vInst;
 
     gl_Position = vec4(0, 0, 0, 1);
 }
@@ -0,0 +1,20 @@
+#version 440 core
+
+layout(std430, binding=3) buffer Section {
+    vec4 sect_verts[];
+};
+
+layout(std140, binding=1) uniform Matrices {
+    mat4 model;
+    vec4 offset;
+
+    mat4 view;
+    mat4 proj;
+};
+
+out vec4 pos;
+
+void main() {
+    pos = sect_verts[gl_VertexID];
+    gl_Position = proj * view * vec4(pos.xyz, 1);
+}
@@ -1,19 +1,53 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include <framework.h>
 #include <gl_util.h>
+#include <program_cache.h>
 #include <vsr/vsr.h>
 
+#include "cull.h"
+#include "export.h"
 #include "glmutil.h"
+#include "layout.h"
+#include "lod.h"
 #include "mesh.h"
+#include "mesh_cache.h"
 #include "rotor.h"
+#include "scene.h"
+#include "slice.h"
+#include "slicen.h"
 #include "solids.h"
 
+// set by the build to where the shaders are edited; the binary loads the copy in ./shaders
+#ifndef SIMPLEX_SHADER_SOURCE_DIR
+#define SIMPLEX_SHADER_SOURCE_DIR "shaders"
+#endif
+
 extern "C" {
 __attribute__((dllexport)) DWORD NvOptimusEnablement = 0x00000001;
 }
 
+struct Options {
+    bool headless = false;
+    int frames = -1;
+    float step = 0;
+    std::string out_dir;
+    std::string profile;
+    int scene = 0;
+    int dim = 0;
+    std::string polytope = "cube";
+    std::string export_path;
+    bool watch = false;
+};
+
 struct Matrices {
     glm::mat4 model;
     glm::vec4 offset;
@@ -22,24 +56,161 @@ struct Matrices {
     glm::mat4 proj;
 };
 
+template<std::size_t dim>
+MeshN<dim, dim> polytope(const std::string &name) {
+    if (name == "simplex") return simplex<dim>();
+    if (name == "orthoplex") return orthoplex<dim>();
+    return hypercube<dim>();
+}
+
+/*
+ * Section of a spinning dim-polytope: rotated in dim-D, then sliced one axis
+ * at a time on the CPU down to 3D triangles for tris.vert.
+ */
+template<std::size_t dim>
+std::function<std::vector<glm::vec4>(float)> sectionN(const std::string &name) {
+    return [mesh = polytope<dim>(name), slicer = SlicerN()](float time) mutable {
+        auto rot = identityN<dim>();
+        for (unsigned i = 0; i + 1 < dim; ++i)
+            rot = rot * rotN<dim>(i, i + 1, time * (1 + .3f * i) / 3);
+
+        std::array<float, dim - 3> h{};
+        for (unsigned i = 0; i < h.size(); ++i)
+            h[i] = std::sin(time / 2 + i) * .3f;
+
+        return triangles(slicer.sliceTo3(transform(mesh, rot, VecN<dim>{}), h.data()));
+    };
+}
+
 class GLApp : public App {
     Mesh<4> mesh = Mesh<4>({}, {});
+    std::vector<Instance> instances;
 
     Matrices matrices{};
 
-    GLuint cell_array{};
+    /*
+     * One index per instance, built once the model has held still for a
+     * frame; while it keeps changing, cells are culled in a linear pass.
+     */
+    std::vector<WIndex> w_indices;
+    Slicer w_slicer;
+    glm::mat4 w_index_model{};
+    bool w_index_stale = true;
+    bool w_index_built = false;
+
+    /// culled cells of instance i are cull_inds[cull_first[i] * 4 ..][.. cull_count[i] * 4]
+    std::vector<unsigned> cull_inds;
+    std::vector<unsigned> cull_first, cull_count;
+
+    GLuint cell_array{}, cull_array{}, tris_array{}, edge_array{}, sect_elem_array{};
+
+    GLuint cell_vert_buf{}, cell_elem_arr_buf{}, cull_elem_arr_buf{};
+    GLuint edge_elem_buf{};
+    GLsizei edge_ind_count = 0;
+    GLuint inst_buf{}, inst_id_arr_buf{};
 
-    GLuint cell_vert_buf{}, cell_elem_arr_buf{}, matrix_buffer{};
+    util::StreamBuffer<Matrices> matrix_stream;
+    GLuint sect_vert_buf{}, sect_cmd_buf{}, sect_elem_buf{};
+    GLsizeiptr sect_buf_size = 0;
+
+    /// sect.geom output is captured into sect_vert_buf through sect_xfb
+    GLuint sect_xfb{}, sect_xfb_query{};
 
     GLuint matrix_binding_point = 1;
     GLuint verts_binding_point = 1;
+    GLuint cells_binding_point = 2;
+    GLuint sect_binding_point = 3;
+    GLuint command_binding_point = 4;
+    GLuint instances_binding_point = 5;
+
+    GLuint wire_prog{}, sect_prog{}, edge_prog{};
+    GLuint sect_comp_prog{}, tris_prog{};
+
+    GLint sect_comp_first_loc{}, sect_comp_count_loc{}, sect_comp_instance_loc{};
 
-    GLuint wire_prog{}, sect_prog{};
+    /// linked programs are cached next to the meshes; with --watch, shader edits relink them live
+    ProgramCache programs{meshCacheDir()};
+    bool watch_shaders = false;
+
+    /// with --scene N, N cell frames on a grid are drawn through the scene instead
+    Scene scene;
+    int scene_frames = 0;
+    float scene_extent = 1;
+
+    /// each scene object draws the level of detail of the cell mesh that suits its size on screen
+    struct SceneObject {
+        Scene::ObjectId id;
+        Instance instance;
+    };
+
+    LodMesh scene_lod;
+    std::vector<Scene::MeshId> scene_levels;
+    std::vector<SceneObject> scene_objects;
+
+    /// with --dim N, the section of an N-D polytope computed on the CPU each frame
+    std::function<std::vector<glm::vec4>(float)> section_n;
+    GLsizei section_n_size = 0;
 
     bool DRAW_WIRE = true;
+    bool COMPUTE_SECT = false;
+    bool CULL_SECT = true;
+    bool CACHE_SECT = false;
+    bool PAUSE_4D = false;
+    bool INDEXED_SECT = false;
+    bool LOD = true;
+
+    /// with INDEXED_SECT, the section is built on the CPU with one intersection per unique edge
+    EdgeTable edge_table;
+    Slicer slicer;
+    Mesh<3> sect_mesh = Mesh<3>({}, {});
+
+    /// the 4D transform the captured section in sect_vert_buf was computed for
+    glm::mat4 sect_model{};
+    glm::vec4 sect_offset{};
+    bool sect_valid = false;
+    bool sect_by_xfb = false;
+
+    /// a pending section export: export_verts vertices in export_buf
+    std::string export_path;
+    GLuint export_buf{};
+    GLsync export_fence{};
+    GLuint export_verts = 0;
+    int export_count = 0;
+
+    /// 4D animation clock, which stops while paused; the camera orbits independently
+    float time_4d = 0;
+    float yaw = 0, pitch = 0;
+    bool dragging = false;
+    double drag_x = 0, drag_y = 0;
 
     void init() override {
-        mesh = tesseract_cell_frame(.125f);
+        // map every shader at once; each build below then waits only for its own file.
+        // The cached mesh is left out: cachedMesh() maps it itself, and may rewrite it
+        resources().prefetch({
+            "shaders/main.vert", "shaders/tris.vert", "shaders/edge.vert",
+            "shaders/sect.geom", "shaders/wire.geom",
+            "shaders/sect.frag", "shaders/wire.frag",
+            "shaders/sect.comp",
+        });
+
+        auto cached = cachedMesh<4>("layout(simplify(tesseract_cell_frame_instanced(0.125).mesh,0.0001))", [this] {
+            // only on a cache miss; the numbers go to the --profile dump
+            auto &profiler = getProfiler();
+
+            SimplifyStats stats{};
+            auto m = simplify(tesseract_cell_frame_instanced(.125f).mesh, 1e-4f, &stats);
+            profiler.record("init.simplify.verts_removed", (double) (stats.verts_before - stats.verts_after));
+            profiler.record("init.simplify.cells_removed", (double) (stats.prims_before - stats.prims_after));
+
+            LayoutReport layout{};
+            m = optimizeLayout(m, &layout);
+            profiler.record("init.layout.acmr", layout.after.acmr);
+            profiler.record("init.layout.line_misses", layout.after.line_misses);
+            profiler.record("init.layout.reordered", layout.reordered);
+            return m;
+        });
+        mesh = cached.mesh();
+        instances = tesseract_cell_frame_instances();
 
         //region Uniforms
         matrices = {
@@ -52,76 +223,359 @@ class GLApp : public App {
         //endregion
 
         //region Shaders
-        GLuint main_vs = util::buildShader(GL_VERTEX_SHADER, {"shaders/main.vert"});
-        GLuint sect_fs = util::buildShader(GL_FRAGMENT_SHADER, {"shaders/sect.frag"});
-        GLuint wire_fs = util::buildShader(GL_FRAGMENT_SHADER, {"shaders/wire.frag"});
-        GLuint sect_gs = util::buildShader(GL_GEOMETRY_SHADER, {"shaders/sect.geom"});
-        GLuint wire_gs = util::buildShader(GL_GEOMETRY_SHADER, {"shaders/wire.geom"});
-
-        wire_prog = util::buildProgram(false, {main_vs, wire_fs, wire_gs});
-        sect_prog = util::buildProgram(false, {main_vs, sect_fs, sect_gs});
-
-        glDeleteShader(main_vs);
-        glDeleteShader(sect_fs);
-        glDeleteShader(wire_fs);
-        glDeleteShader(sect_gs);
-        glDeleteShader(wire_gs);
+        {
+            auto timer = getProfiler().cpu("shaders");
+
+            programs.build(wire_prog, {"shaders/main.vert", "shaders/wire.frag", "shaders/wire.geom"});
+            programs.build(sect_prog, {"shaders/main.vert", "shaders/sect.frag", "shaders/sect.geom"}, {"pos"});
+            programs.build(sect_comp_prog, {"shaders/sect.comp"});
+            programs.build(tris_prog, {"shaders/tris.vert", "shaders/sect.frag"});
+            programs.build(edge_prog, {"shaders/edge.vert", "shaders/wire.frag"});
+        }
+        getProfiler().record("init.programs.loaded", (double) programs.loaded());
+        getProfiler().record("init.programs.compiled", (double) programs.compiled());
+
+        // the build copies the shaders next to the binary; edits are made to the sources
+        if (watch_shaders && !programs.watch("shaders/", SIMPLEX_SHADER_SOURCE_DIR "/"))
+            fprintf(stderr, "Cannot watch shaders for changes\n");
+
+        locateUniforms();
         //endregion
 
         //region Buffers
         glGenBuffers(1, &cell_vert_buf);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, verts_binding_point, cell_vert_buf);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, cell_vert_buf);
-        util::bufferData(GL_SHADER_STORAGE_BUFFER, mesh.verts, GL_STATIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, cached.vertCount() * sizeof(glm::vec4), cached.verts(), GL_STATIC_DRAW);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
         glGenBuffers(1, &cell_elem_arr_buf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cells_binding_point, cell_elem_arr_buf);
         glBindBuffer(GL_ARRAY_BUFFER, cell_elem_arr_buf);
-        util::bufferData(GL_ARRAY_BUFFER, mesh.inds, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, cached.indCount() * sizeof(unsigned), cached.inds(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // refilled every frame with only the cells that straddle the hyperplane
+        glGenBuffers(1, &cull_elem_arr_buf);
+
+        // each edge shared by several cells is drawn once
+        auto edge_inds = edgeIndices(mesh);
+        edge_ind_count = (GLsizei) edge_inds.size();
+        getProfiler().record("init.edges", (double) (edge_inds.size() / 2));
+
+        edge_table.build(mesh);
+
+        glGenBuffers(1, &edge_elem_buf);
+        glBindBuffer(GL_ARRAY_BUFFER, edge_elem_buf);
+        util::bufferData(GL_ARRAY_BUFFER, edge_inds, GL_STATIC_DRAW);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        glGenBuffers(1, &matrix_buffer);
-        glBindBufferBase(GL_UNIFORM_BUFFER, matrix_binding_point, matrix_buffer);
-        glBindBuffer(GL_UNIFORM_BUFFER, matrix_buffer);
-        util::bufferData(GL_UNIFORM_BUFFER, matrices, GL_STREAM_DRAW);
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glGenBuffers(1, &inst_buf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instances_binding_point, inst_buf);
+        uploadInstances();
+
+        // instance i reads vInst = i; with glDrawArraysInstancedBaseInstance this honors the base instance
+        std::vector<int> inst_ids(instances.size());
+        for (size_t i = 0; i < inst_ids.size(); ++i) inst_ids[i] = (int) i;
+
+        glGenBuffers(1, &inst_id_arr_buf);
+        glBindBuffer(GL_ARRAY_BUFFER, inst_id_arr_buf);
+        util::bufferData(GL_ARRAY_BUFFER, inst_ids, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // a tetrahedron's section is at most a quad, i.e. two triangles
+        sect_buf_size = (GLsizeiptr) (mesh.size() * instances.size() * 6 * sizeof(glm::vec4));
+        glGenBuffers(1, &sect_vert_buf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, sect_binding_point, sect_vert_buf);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sect_vert_buf);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sect_buf_size, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glGenTransformFeedbacks(1, &sect_xfb);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, sect_xfb);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, sect_vert_buf);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+        glGenQueries(1, &sect_xfb_query);
+
+        util::DrawArraysIndirectCommand command{0, 1, 0, 0};
+        glGenBuffers(1, &sect_elem_buf);
+
+        glGenBuffers(1, &sect_cmd_buf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, command_binding_point, sect_cmd_buf);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, sect_cmd_buf);
+        util::bufferData(GL_DRAW_INDIRECT_BUFFER, command, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        matrix_stream.init(GL_UNIFORM_BUFFER);
         //endregion
 
         //region Vertex Arrays
+        auto ind_loc = (GLuint) glGetAttribLocation(wire_prog, "vInds");
+        auto inst_loc = (GLuint) glGetAttribLocation(wire_prog, "vInst");
+
         glGenVertexArrays(1, &cell_array);
         glBindVertexArray(cell_array);
 
         glBindBuffer(GL_ARRAY_BUFFER, cell_elem_arr_buf);
-        auto ind_loc = (GLuint) glGetAttribLocation(wire_prog, "vInds");
         glEnableVertexAttribArray(ind_loc);
         glVertexAttribIPointer(ind_loc, 4, GL_UNSIGNED_INT, sizeof(int) * 4, (void *) nullptr);
+
+        glBindBuffer(GL_ARRAY_BUFFER, inst_id_arr_buf);
+        glEnableVertexAttribArray(inst_loc);
+        glVertexAttribIPointer(inst_loc, 1, GL_INT, sizeof(int), (void *) nullptr);
+        glVertexAttribDivisor(inst_loc, 1);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+        glBindVertexArray(0);
+
+        glGenVertexArrays(1, &cull_array);
+        glBindVertexArray(cull_array);
+
+        glBindBuffer(GL_ARRAY_BUFFER, cull_elem_arr_buf);
+        glEnableVertexAttribArray(ind_loc);
+        glVertexAttribIPointer(ind_loc, 4, GL_UNSIGNED_INT, sizeof(int) * 4, (void *) nullptr);
+
+        glBindBuffer(GL_ARRAY_BUFFER, inst_id_arr_buf);
+        glEnableVertexAttribArray(inst_loc);
+        glVertexAttribIPointer(inst_loc, 1, GL_INT, sizeof(int), (void *) nullptr);
+        glVertexAttribDivisor(inst_loc, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(0);
+
+        // tris.vert pulls everything from the section buffer
+        glGenVertexArrays(1, &tris_array);
+
+        // indexed sections reuse tris.vert, which reads the vertex named by each index
+        glGenVertexArrays(1, &sect_elem_array);
+        glBindVertexArray(sect_elem_array);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sect_elem_buf);
+        glBindVertexArray(0);
+
+        // edge.vert pulls vertices by index, so only the element buffer is attached
+        glGenVertexArrays(1, &edge_array);
+        glBindVertexArray(edge_array);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, edge_elem_buf);
         glBindVertexArray(0);
         //endregion
+
+        if (scene_frames) initScene(ind_loc, inst_loc);
     };
 
+    /// every frame shares the one cell mesh; each of its eight cells is an object
+    void initScene(GLuint ind_loc, GLuint inst_loc) {
+        scene.init(ind_loc, inst_loc);
+
+        scene_lod = buildLod(mesh);
+        for (unsigned i = 0; i < scene_lod.count(); ++i) {
+            scene_levels.push_back(scene.addMesh(scene_lod.levels[i]));
+            getProfiler().record("init.lod" + std::to_string(i) + ".cells", scene_lod.levels[i].size());
+            getProfiler().record("init.lod" + std::to_string(i) + ".error", scene_lod.errors[i]);
+        }
+
+        auto cell = scene_levels[0];
+
+        int side = (int) std::ceil(std::cbrt((float) scene_frames));
+        float spacing = 3;
+        scene_extent = side;
+
+        for (int f = 0; f < scene_frames; ++f) {
+            glm::vec4 pos(
+                f % side - (side - 1) / 2.f,
+                f / side % side - (side - 1) / 2.f,
+                f / side / side - (side - 1) / 2.f,
+                0);
+
+            for (const auto &inst : instances) {
+                Instance instance{inst.model, inst.offset + pos * spacing};
+                scene_objects.push_back({scene.addObject(cell, instance), instance});
+            }
+        }
+
+        scene.upload();
+        getProfiler().record("init.scene.objects", scene.objectCount());
+    }
+
+    /// uniform locations change when a program is relinked
+    void locateUniforms() {
+        sect_comp_first_loc = glGetUniformLocation(sect_comp_prog, "cell_first");
+        sect_comp_count_loc = glGetUniformLocation(sect_comp_prog, "cell_count");
+        sect_comp_instance_loc = glGetUniformLocation(sect_comp_prog, "instance");
+    }
+
     void update() override {
+        if (programs.poll()) {
+            locateUniforms();
+            sect_valid = false;
+        }
+
         int width, height;
         glfwGetFramebufferSize(getWindow(), &width, &height);
         float ratio = (float) width / height;
 
+        if (!PAUSE_4D) time_4d += getTimeDelta();
+
         matrices.model = glm::identity<glm::mat4>() *
-//            rotor(glm::vec4(1, 0, 0, 0), glm::vec4(0, 0, 0, 1), getTime() / 3) *
-//            rotor(glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0), getTime() / 3) *
+//            rotor(glm::vec4(1, 0, 0, 0), glm::vec4(0, 0, 0, 1), time_4d / 3) *
+//            rotor(glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0), time_4d / 3) *
 
-            rotor(glm::vec4(1, 1, 1, 0), glm::vec4(0, 0, 0, 1), getTime() / 3) *
-            rotor(glm::vec4(1, 0, 0, 0), glm::vec4(0, 0, 1, 0), getTime() / 3) *
+            rotor(glm::vec4(1, 1, 1, 0), glm::vec4(0, 0, 0, 1), time_4d / 3) *
+            rotor(glm::vec4(1, 0, 0, 0), glm::vec4(0, 0, 1, 0), time_4d / 3) *
             1.f;
 
-        matrices.offset = glm::vec4(0,0,0,sin(getTime() / 2) * 0.9f);
+        matrices.offset = glm::vec4(0,0,0,sin(time_4d / 2) * 0.9f);
+
+        glm::vec3 eye = glm::vec3(
+            std::sin(yaw) * std::cos(pitch),
+            std::sin(pitch),
+            -std::cos(yaw) * std::cos(pitch)) * 4.f * scene_extent;
+
+        matrices.view = glm::lookAt(eye, glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+        matrices.proj = glm::perspective(1.f, ratio, 0.1f, 20.0f * scene_extent);
+
+        matrix_stream.next() = matrices;
+        matrix_stream.bind(matrix_binding_point);
+
+        if (section_n) sliceN();
+        else if (scene_frames) {
+            selectLod((float) height);
+            scene.upload();
+        }
+        else if (!(CACHE_SECT && sectionCached())) {
+            if (INDEXED_SECT) sliceIndexed();
+            else if (CULL_SECT) cull();
+        }
+    }
+
+    /*
+     * Picks each object's level from the on-screen size of the section of
+     * its bounding sphere. Objects the hyperplane misses entirely are not
+     * drawn at all.
+     */
+    void selectLod(float viewport_height) {
+        auto timer = getProfiler().cpu("lod");
+
+        size_t cells = 0;
+        for (const auto &obj : scene_objects) {
+            glm::mat4 mat = matrices.model * obj.instance.model;
+            glm::vec4 center = mat * scene_lod.bounds.center + matrices.model * obj.instance.offset + matrices.offset;
+
+            float scale = 0;
+            for (int c = 0; c < 4; ++c) scale = std::max(scale, std::sqrt(glm::dot(mat[c], mat[c])));
+
+            float pixels = sectionPixels(center, scene_lod.bounds.radius * scale,
+                matrices.view, matrices.proj, viewport_height);
+
+            // without a section the object is still drawn as a wireframe, sized by its whole bounds
+            bool hidden = pixels < 0;
+            if (hidden) {
+                glm::vec4 whole = center;
+                whole.w = 0;
+                pixels = sectionPixels(whole, scene_lod.bounds.radius * scale,
+                    matrices.view, matrices.proj, viewport_height);
+            }
+
+            unsigned level = LOD ? lodLevel(pixels, scene_lod.count()) : 0;
+            scene.setMesh(obj.id, scene_levels[level]);
+            scene.setHidden(obj.id, hidden);
+            if (!hidden) cells += scene_lod.levels[level].size();
+        }
+
+        getProfiler().record("lod.cells", (double) cells);
+    }
+
+    void sliceN() {
+        std::vector<glm::vec4> tris;
+        {
+            auto timer = getProfiler().cpu("slice");
+            tris = section_n((float) getTime());
+        }
+
+        section_n_size = (GLsizei) tris.size();
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sect_vert_buf);
+        util::bufferData(GL_SHADER_STORAGE_BUFFER, tris, GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /*
+     * Builds the indexed section of every instance on the CPU and uploads it
+     * over sect_vert_buf, with its indices in sect_elem_buf.
+     */
+    void sliceIndexed() {
+        {
+            auto timer = getProfiler().cpu("slice");
+
+            sect_mesh.verts.clear();
+            sect_mesh.inds.clear();
+            for (const auto &inst : instances) {
+                slicer.sliceIndexed(mesh, edge_table,
+                    matrices.model * inst.model, matrices.model * inst.offset + matrices.offset, sect_mesh);
+            }
+        }
+
+        // at most one vertex per edge and instance, well within the per-cell size of sect_vert_buf
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sect_vert_buf);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sect_mesh.verts.size() * sizeof(glm::vec4), sect_mesh.verts.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, sect_elem_buf);
+        util::bufferData(GL_ARRAY_BUFFER, sect_mesh.inds, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        sect_model = matrices.model;
+        sect_offset = matrices.offset;
+        sect_valid = true;
+        sect_by_xfb = false;
+    }
+
+    /// instance transforms can be changed and re-uploaded without touching the mesh
+    void uploadInstances() {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, inst_buf);
+        util::bufferData(GL_SHADER_STORAGE_BUFFER, instances, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        w_index_stale = true;
+        sect_valid = false;
+    }
+
+    /// whether sect_vert_buf still holds the section for the current 4D transform
+    bool sectionCached() const {
+        return sect_valid && matrices.model == sect_model && matrices.offset == sect_offset;
+    }
+
+    void cull() {
+        // an instance's cells see `model * inst.model` and `model * inst.offset + offset`;
+        // the index only depends on the matrix, the w offset is applied per query
+        bool moving = w_index_stale || matrices.model != w_index_model;
+        if (moving) {
+            w_index_model = matrices.model;
+            w_index_stale = false;
+            w_index_built = false;
+        } else if (!w_index_built) {
+            w_indices.resize(instances.size());
+            for (size_t i = 0; i < instances.size(); ++i)
+                w_indices[i].build(mesh, matrices.model * instances[i].model);
+            w_index_built = true;
+        }
+
+        cull_first.resize(instances.size());
+        cull_count.resize(instances.size());
+        cull_inds.clear();
+
+        for (size_t i = 0; i < instances.size(); ++i) {
+            glm::vec4 offset = matrices.model * instances[i].offset + matrices.offset;
 
-        matrices.view = glm::lookAt(glm::vec3(0, 0, -4), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
-        matrices.proj = glm::perspective(1.f, ratio, 0.1f, 20.0f);
+            cull_first[i] = (unsigned) cull_inds.size() / 4;
+            cull_count[i] = moving
+                ? cullLinear(mesh, w_slicer, matrices.model * instances[i].model, offset, cull_inds)
+                : w_indices[i].cull(mesh, offset.w, cull_inds);
+        }
 
-        glBindBuffer(GL_UNIFORM_BUFFER, matrix_buffer);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Matrices), &matrices);
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, cull_elem_arr_buf);
+        util::bufferData(GL_ARRAY_BUFFER, cull_inds, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
     void display() override {
@@ -136,21 +590,250 @@ class GLApp : public App {
 
         glEnable(GL_DEPTH_TEST);
 
-        glBindVertexArray(cell_array);
+        if (section_n) {
+            auto timer = getProfiler().gpu("sect");
+
+            glBindVertexArray(tris_array);
+            glUseProgram(tris_prog);
+            glDrawArrays(GL_TRIANGLES, 0, section_n_size);
+            glBindVertexArray(0);
+        } else if (scene_frames) {
+            displayScene();
+        } else {
+            displayMesh();
+        }
 
-        glUseProgram(sect_prog);
-        glDrawArrays(GL_POINTS, 0, mesh.size());
+        matrix_stream.fence();
+        swapBuffers();
+
+        pollExport(false);
+    }
+
+    void displayScene() {
+        scene.bind(verts_binding_point, instances_binding_point);
+
+        {
+            auto timer = getProfiler().gpu("sect");
+
+            glUseProgram(sect_prog);
+            scene.draw(true);
+        }
 
         if (DRAW_WIRE) {
+            auto timer = getProfiler().gpu("wire");
+
             glClear(GL_DEPTH_BUFFER_BIT);
             glUseProgram(wire_prog);
-            glDrawArrays(GL_POINTS, 0, mesh.size());
+            scene.draw();
+        }
+    }
+
+    void displayMesh() {
+        {
+            auto timer = getProfiler().gpu("sect");
+
+            if (INDEXED_SECT) {
+                glBindVertexArray(sect_elem_array);
+                glUseProgram(tris_prog);
+                glDrawElements(GL_TRIANGLES, (GLsizei) sect_mesh.inds.size(), GL_UNSIGNED_INT, nullptr);
+            } else if (COMPUTE_SECT || CACHE_SECT || !export_path.empty()) {
+                drawSectCaptured();
+            } else {
+                drawSectGeometry();
+            }
+        }
+
+        if (!export_path.empty() && INDEXED_SECT) exportIndexed();
+        else if (!export_path.empty()) beginExport();
+
+        if (DRAW_WIRE) {
+            auto timer = getProfiler().gpu("wire");
+
+            glClear(GL_DEPTH_BUFFER_BIT);
+            glBindVertexArray(edge_array);
+            glUseProgram(edge_prog);
+            glDrawElementsInstanced(GL_LINES, edge_ind_count, GL_UNSIGNED_INT, nullptr, instances.size());
         }
 
         glBindVertexArray(0);
+    }
 
-        glFinish();
-        swapBuffers();
+    /// the section straight through sect.geom, culled per instance or over every cell
+    void drawSectGeometry() {
+        glUseProgram(sect_prog);
+
+        if (CULL_SECT) {
+            glBindVertexArray(cull_array);
+            for (GLuint i = 0; i < instances.size(); ++i) {
+                if (cull_count[i])
+                    glDrawArraysInstancedBaseInstance(GL_POINTS, cull_first[i], cull_count[i], 1, i);
+            }
+        } else {
+            glBindVertexArray(cell_array);
+            glDrawArraysInstanced(GL_POINTS, 0, mesh.size(), instances.size());
+        }
+    }
+
+    /*
+     * Captures the section into sect_vert_buf and draws it. The compute pass
+     * writes it with an indirect command; otherwise sect.geom renders it and
+     * transform feedback records its triangles in the same pass. With
+     * CACHE_SECT the capture is skipped while the 4D transform is unchanged,
+     * so camera-only frames are a single triangle draw. It is off by default
+     * (toggle with X), since the cache never hits while the animation runs.
+     */
+    void drawSectCaptured() {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, sect_cmd_buf);
+
+        if (!(CACHE_SECT && sectionCached())) {
+            if (COMPUTE_SECT) {
+                computeSect();
+            } else {
+                captureSect();
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+                return;
+            }
+        }
+
+        glBindVertexArray(tris_array);
+        glUseProgram(tris_prog);
+        if (sect_by_xfb) glDrawTransformFeedback(GL_TRIANGLES, sect_xfb);
+        else glDrawArraysIndirect(GL_TRIANGLES, nullptr);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    void captureSect() {
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, sect_xfb);
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, sect_xfb_query);
+        glBeginTransformFeedback(GL_TRIANGLES);
+
+        drawSectGeometry();
+
+        glEndTransformFeedback();
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+        // tris.vert reads the captured vertices back as a storage buffer
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        sect_model = matrices.model;
+        sect_offset = matrices.offset;
+        sect_valid = true;
+        sect_by_xfb = true;
+    }
+
+    void computeSect() {
+        util::DrawArraysIndirectCommand command{0, 1, 0, 0};
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cells_binding_point,
+            CULL_SECT ? cull_elem_arr_buf : cell_elem_arr_buf);
+
+        glUseProgram(sect_comp_prog);
+        for (GLuint i = 0; i < instances.size(); ++i) {
+            GLuint first = CULL_SECT ? cull_first[i] : 0;
+            GLuint count = CULL_SECT ? cull_count[i] : mesh.size();
+            if (!count) continue;
+
+            glUniform1ui(sect_comp_first_loc, first);
+            glUniform1ui(sect_comp_count_loc, count);
+            glUniform1i(sect_comp_instance_loc, (GLint) i);
+            glDispatchCompute((count + 63) / 64, 1, 1);
+        }
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+        sect_model = matrices.model;
+        sect_offset = matrices.offset;
+        sect_valid = true;
+        sect_by_xfb = false;
+    }
+
+    /*
+     * Copies the vertices of the captured section into export_buf on the GPU
+     * and fences it; pollExport() writes the file once the copy is done. The
+     * vertex count, from the transform feedback query or the indirect
+     * command, is read first, which waits for this frame's section pass but
+     * keeps the copy to the written range.
+     */
+    void beginExport() {
+        if (export_fence || !sect_valid) return;
+
+        GLuint count = 0;
+        if (sect_by_xfb) {
+            glGetQueryObjectuiv(sect_xfb_query, GL_QUERY_RESULT, &count);
+            count *= 3;
+        } else {
+            glBindBuffer(GL_COPY_READ_BUFFER, sect_cmd_buf);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(count), &count);
+        }
+        count = std::min(count, (GLuint) (sect_buf_size / sizeof(glm::vec4)));
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        // an empty range cannot be mapped, and there is nothing to wait for
+        if (!count) {
+            writeCaptured(nullptr, 0);
+            return;
+        }
+
+        auto bytes = (GLsizeiptr) (count * sizeof(glm::vec4));
+        if (!export_buf) glGenBuffers(1, &export_buf);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, export_buf);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_READ);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, sect_vert_buf);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        export_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        export_verts = count;
+    }
+
+    /// the indexed section is already on the CPU, so it is written right away
+    void exportIndexed() {
+        if (writeSection(export_path, sect_mesh))
+            printf("export: %zu triangles to %s\n", sect_mesh.inds.size() / 3, export_path.c_str());
+        else
+            fprintf(stderr, "Cannot write section to %s\n", export_path.c_str());
+
+        export_path.clear();
+    }
+
+    /// writes a finished export straight from the mapped buffer; with `wait`, blocks until it is finished
+    void pollExport(bool wait) {
+        if (!export_fence) return;
+
+        GLenum status = glClientWaitSync(export_fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+        glDeleteSync(export_fence);
+        export_fence = nullptr;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, export_buf);
+        auto bytes = (GLsizeiptr) (export_verts * sizeof(glm::vec4));
+        auto verts = (const glm::vec4 *) glMapBufferRange(GL_COPY_READ_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+        if (verts) {
+            writeCaptured(verts, export_verts);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        } else {
+            export_path.clear();
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    void writeCaptured(const glm::vec4 *verts, GLuint count) {
+        if (writeSection(export_path, verts, count))
+            printf("export: %u triangles to %s\n", count / 3, export_path.c_str());
+        else
+            fprintf(stderr, "Cannot write section to %s\n", export_path.c_str());
+
+        export_path.clear();
+    }
+
+    void deinit() override {
+        pollExport(true);
     }
 
     void onKey(int key, int scan_code, int action, int mods) override {
@@ -161,14 +844,163 @@ class GLApp : public App {
         if (action == GLFW_PRESS && key == GLFW_KEY_SPACE) {
             DRAW_WIRE = !DRAW_WIRE;
         }
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_C) {
+            COMPUTE_SECT = !COMPUTE_SECT;
+        }
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_K) {
+            CULL_SECT = !CULL_SECT;
+            sect_valid = false;
+        }
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_X) {
+            CACHE_SECT = !CACHE_SECT;
+        }
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_I) {
+            INDEXED_SECT = !INDEXED_SECT;
+            sect_valid = false;
+        }
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_L) {
+            LOD = !LOD;
+        }
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_P) {
+            PAUSE_4D = !PAUSE_4D;
+        }
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_E && export_path.empty()) {
+            char name[32];
+            snprintf(name, sizeof(name), "/section_%05d.ply", export_count++);
+            export_path = (out_dir.empty() ? std::string(".") : out_dir) + name;
+        }
+    }
+
+    /// dragging with the left button orbits the camera
+    void onMouseButton(int button, int action, int mods) override {
+        if (button != GLFW_MOUSE_BUTTON_LEFT) return;
+
+        dragging = action == GLFW_PRESS;
+        if (dragging) glfwGetCursorPos(getWindow(), &drag_x, &drag_y);
+    }
+
+    void onCursorPos(double x, double y) override {
+        if (!dragging) return;
+
+        yaw += (float) (x - drag_x) * .01f;
+        pitch = std::max(-1.5f, std::min(1.5f, pitch + (float) (y - drag_y) * .01f));
+
+        drag_x = x;
+        drag_y = y;
+    }
+
+    void onFrame(int frame, int width, int height, const unsigned char *pixels) override {
+        if (out_dir.empty()) return;
+
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%05d.ppm", frame);
+
+        FILE *file = fopen((out_dir + name).c_str(), "wb");
+        if (!file) {
+            fprintf(stderr, "Cannot write frame %d to %s\n", frame, out_dir.c_str());
+            return;
+        }
+
+        fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+        // rows arrive bottom-up as RGBA; PPM wants top-down RGB
+        std::vector<unsigned char> row((size_t) width * 3);
+        for (int y = height - 1; y >= 0; --y) {
+            const unsigned char *src = pixels + (size_t) y * width * 4;
+            for (int x = 0; x < width; ++x) {
+                row[x * 3 + 0] = src[x * 4 + 0];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
+            }
+            fwrite(row.data(), 1, row.size(), file);
+        }
+
+        fclose(file);
     }
 
+    std::string out_dir;
+
 public:
-    GLApp() : App(4, 4) {}
+    explicit GLApp(const Options &options) : App(4, 4), watch_shaders(options.watch),
+        scene_frames(options.scene), export_path(options.export_path), out_dir(options.out_dir) {
+        setHeadless(options.headless);
+        setFrameLimit(options.frames);
+        setTimeStep(options.step);
+        setProfileOutput(options.profile);
+
+        switch (options.dim) {
+        case 0:
+            break;
+        case 4:
+            section_n = sectionN<4>(options.polytope);
+            break;
+        case 5:
+            section_n = sectionN<5>(options.polytope);
+            break;
+        case 6:
+            section_n = sectionN<6>(options.polytope);
+            break;
+        case 7:
+            section_n = sectionN<7>(options.polytope);
+            break;
+        case 8:
+            section_n = sectionN<8>(options.polytope);
+            break;
+        default:
+            fprintf(stderr, "--dim must be between 4 and 8\n");
+            exit(EXIT_FAILURE);
+        }
+    }
 };
 
+Options parseArgs(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        bool more = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--headless")) {
+            options.headless = true;
+        } else if (!strcmp(argv[i], "--frames") && more) {
+            options.frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--step") && more) {
+            options.step = (float) atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && more) {
+            options.out_dir = argv[++i];
+        } else if (!strcmp(argv[i], "--profile") && more) {
+            options.profile = argv[++i];
+        } else if (!strcmp(argv[i], "--scene") && more) {
+            options.scene = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--dim") && more) {
+            options.dim = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--polytope") && more) {
+            options.polytope = argv[++i];
+        } else if (!strcmp(argv[i], "--watch")) {
+            options.watch = true;
+        } else if (!strcmp(argv[i], "--export") && more) {
+            options.export_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--headless] [--frames N] [--step SECONDS] [--out DIR] [--profile FILE]"
+                " [--scene N] [--dim N] [--polytope cube|simplex|orthoplex] [--export FILE.ply|FILE.obj] [--watch]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // a headless run needs an end and a reproducible clock
+    if (options.headless && options.frames < 0) options.frames = 240;
+    if (options.headless && options.step <= 0) options.step = 1.f / 60;
+
+    return options;
+}
 
-int main() {
-    GLApp app = GLApp();
+int main(int argc, char **argv) {
+    GLApp app = GLApp(parseArgs(argc, argv));
     app.launch();
 }
\ No newline at end of file